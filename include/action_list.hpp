@@ -3,6 +3,7 @@
 #define ACTION_LIST_HPP_
 
 #include <vector>
+#include <string>
 #include <functional>
 #include <boost/property_tree/ptree.hpp>
 #include "actions.hpp"
@@ -14,6 +15,16 @@ class Job;
 struct ConditionalAction {
     std::function<bool(const pt::ptree &, const Job &)> predicate;
     std::function<void(pt::ptree &&, Job &&)> action;
+    /// The extractor name, as given by the --extract option. It is only set
+    /// in extract mode and names the output stream in fanout mode.
+    std::string name;
+    /// Whether the action reads or modifies the states shared across
+    /// packets, so that its output depends on the order of the packets.
+    bool stateful = false;
+    /// Whether the predicate or the action reads the XML tree. If none in
+    /// the list does, the text of the packet is not parsed, and they are
+    /// given an empty tree.
+    bool needs_tree = true;
 };
 
 using ActionList = std::vector<ConditionalAction>;
@@ -36,9 +47,11 @@ extern void initialize_action_list_with_extractors();
 /// must put a dummy function at the end of the list.
 extern void initialize_action_list_with_range();
 
-/// Initialize the `g_action_list` to do the deduplicate work.Due to the
-/// same reason as `initialize_action_list_with_extractors()`, we must put
-/// a dummy function at the end of the list.
+/// Initialize the `g_action_list` to do the deduplicate work, by the
+/// content of the packets if `g_duplicate_filter` is set, or by their
+/// timestamps otherwise. Due to the same reason as
+/// `initialize_action_list_with_extractors()`, we must put a dummy function
+/// at the end of the list.
 extern void initialize_action_list_to_dedup();
 
 /// Initialize the `g_action_list` to do the reorder work .Due to the
@@ -46,6 +59,16 @@ extern void initialize_action_list_to_dedup();
 /// a dummy function at the end of the list.
 extern void initialize_action_list_to_reorder();
 
+/// Initialize the `g_action_list` to do the sort work. Since the predicate
+/// function always return true, we do not need another dummy function at
+/// the end of the list.
+extern void initialize_action_list_to_sort();
+
+/// Initialize the `g_action_list` to profile the disorder of the packet
+/// timestamps. Since the predicate function always return true, we do not
+/// need another dummy function at the end of the list.
+extern void initialize_action_list_to_profile_disorder();
+
 /// Initialize the `g_action_list` to do the filter work. Since the
 /// predicate function always return true, we do not need another dummy
 /// function at the end of the list.
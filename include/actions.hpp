@@ -4,6 +4,7 @@
 #include <vector>
 #include <boost/property_tree/ptree.hpp>
 #include "extractor.hpp"
+#include "global_states.hpp"
 
 namespace pt = boost::property_tree;
 
@@ -18,11 +19,24 @@ extern time_t timestamp_str2long(const std::string &timestamp);
 
 extern time_t timestamp_str2long_microsec_hack(const std::string &timestamp);
 
+extern std::string scan_packet_timestamp_text(const std::string &xml);
+
+extern time_t scan_packet_timestamp(const std::string &xml);
+
+extern void drop_packet_with_invalid_timestamp(
+    long job_num, const std::string &timestamp);
+
 extern bool is_tree_having_attribute(
     const pt::ptree &tree, const std::string &key, const std::string &val);
 
 extern bool recursive_find_mobility_control_info(const pt::ptree &tree);
 
+extern const PatternMatches &scan_packet_patterns(const Job &job);
+
+extern bool is_pattern_present(const Job &job, int pattern_id);
+
+extern bool is_mobility_control_info_present(const Job &job);
+
 extern void print_time_of_mobility_control_info(pt::ptree &&tree, Job &&job);
 
 extern void print_timestamp(pt::ptree &&tree, long seq_num);
@@ -90,8 +104,14 @@ extern void extract_rlc_ul_am_all_pdu(pt::ptree &&tree, Job &&job);
 
 extern void echo_packet_if_new(pt::ptree &&tree, Job &&job);
 
+extern void echo_packet_if_unique(pt::ptree &&tree, Job &&job);
+
 extern void update_reorder_window(pt::ptree &&tree, Job &&job);
 
+extern void profile_packet_disorder(pt::ptree &&tree, Job &&job);
+
+extern void add_packet_to_external_sorter(pt::ptree &&tree, Job &&job);
+
 extern void echo_packet_if_match(pt::ptree &&tree, Job &&job);
 
 extern void extract_rlc_dl_config_log_packet(pt::ptree &&tree, Job &&job);
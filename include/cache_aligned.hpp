@@ -0,0 +1,31 @@
+/* Copyright [2020] Zhiyao Ma */
+#ifndef CACHE_ALIGNED_HPP_
+#define CACHE_ALIGNED_HPP_
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+/// The size of a cache line, to which the members shared across threads
+/// are aligned.
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+/// A base class whose derived classes are allocated on cache line
+/// boundaries by `new`. The plain `operator new` of C++14 only guarantees
+/// the alignment of the fundamental types, so the `alignas` padding of an
+/// object on the heap would not really keep its members on separate lines.
+struct CacheAligned {
+    static void *operator new(std::size_t size) {
+        void *p = nullptr;
+        if (::posix_memalign(&p, CACHE_LINE_SIZE, size) != 0) {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+
+    static void operator delete(void *p) {
+        std::free(p);
+    }
+};
+
+#endif  // CACHE_ALIGNED_HPP_
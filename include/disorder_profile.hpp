@@ -0,0 +1,42 @@
+/* Copyright [2020] Zhiyao Ma */
+#ifndef DISORDER_PROFILE_HPP_
+#define DISORDER_PROFILE_HPP_
+
+#include <ctime>
+#include <ostream>
+#include <vector>
+
+/// A streaming profile of the disorder of the packet timestamps. The
+/// inversion distance of a packet is how much older it is than the newest
+/// packet before it, which is the smallest reorder window that puts it in
+/// place. The distances are counted in a log-linear histogram, so the
+/// percentiles are exact up to `1 / SUB_BUCKET_NUM` of their value, with
+/// constant memory however long the input is.
+class DisorderProfile {
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr int SUB_BUCKET_NUM = 1 << SUB_BUCKET_BITS;
+
+    /// The numbers of inverted packets, indexed by `bucket_index`.
+    std::vector<long> buckets;
+    long packet_num = 0;
+    long invalid_packet_num = 0;
+    long inverted_packet_num = 0;
+    /// The newest timestamp seen so far.
+    time_t largest_time = 0;
+    time_t largest_inversion = 0;
+
+    static int bucket_index(time_t distance);
+    static time_t bucket_upper_bound(int index);
+    time_t percentile(double fraction) const;
+ public:
+    DisorderProfile();
+
+    /// Count a packet with the timestamp in microseconds, or -1 if it has
+    /// no valid timestamp.
+    void add(time_t timestamp);
+
+    /// Write the summary of the disorder seen so far.
+    void report(std::ostream &out) const;
+};
+
+#endif  // DISORDER_PROFILE_HPP_
@@ -0,0 +1,46 @@
+/* Copyright [2020] Zhiyao Ma */
+#ifndef DUPLICATE_FILTER_HPP_
+#define DUPLICATE_FILTER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <vector>
+
+/// A set of the hashes of the packet texts seen within a time horizon, to
+/// find the packets repeated by the overlap of adjacent trace chunks.
+class DuplicateFilter {
+    /// A slot of the open addressing hash table. `hash` is 0 if the slot is
+    /// empty.
+    struct Slot {
+        std::uint64_t hash;
+        time_t timestamp;
+    };
+
+    time_t horizon;
+    /// The hash table with linear probing. Its size is a power of 2.
+    std::vector<Slot> slots;
+    std::size_t slot_num_used = 0;
+    /// The hashes in the order of insertion, to evict the old ones.
+    std::deque<Slot> history;
+    /// The newest timestamp seen so far.
+    time_t largest_time = 0;
+
+    std::size_t find(std::uint64_t hash) const;
+    void erase(std::size_t index);
+    void grow();
+    void evict();
+ public:
+    explicit DuplicateFilter(time_t horizon_);
+    ~DuplicateFilter();
+    DuplicateFilter(const DuplicateFilter &) = delete;
+    DuplicateFilter &operator=(const DuplicateFilter &) = delete;
+
+    /// Add the hash of a packet text with the timestamp of the packet.
+    /// Return false if the same hash has been added within the horizon,
+    /// i.e. the packet is a duplicate.
+    bool insert(time_t timestamp, std::uint64_t hash);
+};
+
+#endif  // DUPLICATE_FILTER_HPP_
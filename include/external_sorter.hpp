@@ -0,0 +1,76 @@
+/* Copyright [2020] Zhiyao Ma */
+#ifndef EXTERNAL_SORTER_HPP_
+#define EXTERNAL_SORTER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct SortRun;
+
+/// A temporary file holding a sorted run, as records of the timestamp, the
+/// length and the text of each packet. The file is only open while the run
+/// is written or read, so that the runs waiting to be merged hold neither a
+/// file descriptor nor a buffer. It is unlinked as soon as it is opened for
+/// reading, since it is read only once, or when the object is destroyed.
+class RunFile {
+    std::string path;
+    /// The open file, or nullptr between writing and reading.
+    std::FILE *file = nullptr;
+    std::unique_ptr<char[]> buffer;
+
+    void open(int fd, const char *mode);
+    int close();
+ public:
+    /// Create the file in the directory, and open it for writing.
+    explicit RunFile(const std::string &dir);
+    RunFile(const RunFile &) = delete;
+    RunFile &operator=(const RunFile &) = delete;
+    ~RunFile();
+
+    /// Append a packet to the file.
+    void write(time_t timestamp, const char *text, std::size_t size);
+
+    /// Close the file after writing it.
+    void finish_writing();
+
+    /// Open the file to read it from the beginning.
+    void start_reading();
+
+    /// Read the next packet. Return false, and close the file, at the end
+    /// of the file.
+    bool read(time_t &timestamp, std::string &text);
+};
+
+/// A packet sorter for arbitrary disorder. The packets are collected into
+/// runs in memory, and each full run is sorted and spilled to a temporary
+/// file in the background. The runs are merged when the input ends.
+class ExternalSorter {
+    std::size_t run_size;
+    std::string temp_dir;
+    /// The run being filled.
+    std::unique_ptr<SortRun> run;
+    /// The runs being sorted and spilled, oldest first.
+    std::deque<std::future<std::unique_ptr<RunFile>>> spills;
+    /// The runs already spilled, in the order of the input.
+    std::vector<std::unique_ptr<RunFile>> run_files;
+
+    void spill_run();
+    void finish_oldest_spill();
+    std::size_t merge_file_limit() const;
+ public:
+    /// `run_size` is the memory held by a run before it is spilled, and
+    /// `temp_dir` is the directory of the temporary files.
+    ExternalSorter(std::size_t run_size_, std::string temp_dir_);
+    ~ExternalSorter();
+    void update(time_t timestamp, std::string &&str);
+    void flush();
+};
+
+#endif  // EXTERNAL_SORTER_HPP_
@@ -2,7 +2,10 @@
 #ifndef EXTRACTOR_HPP_
 #define EXTRACTOR_HPP_
 
+#include <cstddef>
 #include <string>
+#include <vector>
+#include "pattern_scanner.hpp"
 
 /// The job structure that the splitter provides to the extractors.
 struct Job {
@@ -12,12 +15,33 @@ struct Job {
     std::string xml_string;
     /// The input file name.
     std::string file_name;
+    /// The index of the input file, i.e. the index to `g_inputs`.
+    int file_idx;
+    /// The offset of the XML string in the input file.
+    long file_offset;
     /// The line number corresponding to the start of the
     /// XML string in the input file.
     long start_line_number;
     /// The line number corresponding to the end of the
     /// XML string in the input file.
     long end_line_number;
+    /// The occurrences of the registered scan patterns in the XML text
+    /// string. It is filled in on first use by `scan_packet_patterns`.
+    mutable PatternMatches pattern_matches;
+};
+
+/// A batch of consecutive jobs, which is passed from the splitter to the
+/// extractors as a whole, and is provided to the in-order executor as a
+/// whole. Small packets thus pay the queueing and sequencing overhead once
+/// per batch rather than once per packet.
+struct JobBatch {
+    /// The sequence number of the batch. It is in ascending order and is
+    /// consecutive.
+    long batch_num;
+    /// The jobs in ascending order of their sequence number.
+    std::vector<Job> jobs;
+    /// The total size of the XML text strings of the jobs.
+    std::size_t xml_size;
 };
 
 /// Start the extractor threads. The number of extractor threads will
@@ -30,12 +54,22 @@ extern void join_extractor();
 /// Terminate all extractor threads prematurely.
 extern void kill_extractor();
 
+/// Tune the number of extractors taking new jobs at run time, between 1
+/// and `g_thread_num`, instead of keeping all of them busy. It must be
+/// called before `start_extractor`.
+extern void enable_adaptive_extractor_num();
+
 /// Notify all extractors threads that the splitter, which acts as the
 /// producer of extractors, has finished execution.
 extern void notify_splitter_finished();
 
-/// Add a new job to the extractors. This function may block if the
-/// `job_queue` is currently full.
-extern void produce_job_to_extractor(Job job);
+/// Add a new batch of jobs to the extractors. This function may block if
+/// the `job_queue` is currently full.
+extern void produce_job_to_extractor(JobBatch batch);
+
+/// Return true if some extractor is parked for lack of jobs. The splitter
+/// then hands out the jobs it has collected right away instead of filling
+/// up the batch.
+extern bool is_extractor_idle();
 
 #endif  // EXTRACTOR_HPP_
@@ -10,8 +10,12 @@
 #include <iostream>
 #include <vector>
 #include <ctime>
-#include <regex>
 #include "sorter.hpp"
+#include "disorder_profile.hpp"
+#include "duplicate_filter.hpp"
+#include "external_sorter.hpp"
+#include "type_filter.hpp"
+#include "pattern_scanner.hpp"
 
 /// The states for the state machine in the main function.
 enum class MainState {
@@ -85,9 +89,32 @@ extern std::vector<std::string> g_input_file_names;
 extern std::vector< std::unique_ptr<std::istream,
                     std::function<void(std::istream*)>> > g_inputs;
 
-/// Parameter: output file stream.
-extern std::unique_ptr<std::ostream,
-                       std::function<void(std::ostream*)> > g_output;
+/// Parameter: output file streams. There is exactly one stream unless the
+/// fanout mode is enabled, in which case each enabled extractor owns one.
+extern std::vector< std::unique_ptr<std::ostream,
+                    std::function<void(std::ostream*)>> > g_outputs;
+
+/// The output stream that ordered tasks write to. It points to one of the
+/// streams in `g_outputs`. In fanout mode the in-order executor switches it
+/// to the stream of the extractor that produced the task being executed.
+extern std::ostream *g_output;
+
+/// The stream that ordered tasks write warnings to. It is buffered in the
+/// same way as the output streams, and goes to stderr.
+extern std::unique_ptr<std::ostream> g_error_output;
+
+/// Parameter: the number of actions that run on every packet in fanout mode.
+/// It is 0 if fanout mode is disabled.
+extern int g_fanout_width;
+
+/// Parameter: whether the output is written by the extractors as soon as
+/// it is ready, with each line prefixed by its job number, instead of being
+/// executed in order.
+extern bool g_unordered;
+
+/// Parameter: whether the packets of all input files are merged by their
+/// timestamps, instead of being read one file after another.
+extern bool g_merge_inputs;
 
 /// The global exception pointer.
 extern std::exception_ptr g_pexcept;
@@ -131,8 +158,17 @@ extern std::string g_latest_seen_ts_string;
 /// The packet sorter.
 extern std::unique_ptr<ReorderWindow> g_reorder_window;
 
-/// The regular expression object used to match against packet type.
-extern std::regex g_packet_type_regex;
+/// The hashes of the packets seen in the content-based deduplication.
+extern std::unique_ptr<DuplicateFilter> g_duplicate_filter;
+
+/// The packet sorter of the sort mode.
+extern std::unique_ptr<ExternalSorter> g_external_sorter;
+
+/// The disorder profile of the profile-disorder mode.
+extern std::unique_ptr<DisorderProfile> g_disorder_profile;
+
+/// The packet type matcher used in the filter mode.
+extern std::unique_ptr<PacketTypeFilter> g_packet_type_filter;
 
 /// Sub threads call this function to propagate caught exception to the
 /// main thread. It changes the main state to Error and set the exception
@@ -2,23 +2,131 @@
 #ifndef IN_ORDER_EXECUTOR_HPP_
 #define IN_ORDER_EXECUTOR_HPP_
 
-#include <functional>
+#include <cstddef>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
 
-/// A function to be executed (a task) associated with a sequence number.
+struct OrderedTask;
+
+/// A type-erased callable with signature `void(OrderedTask &)`, stored
+/// inline without heap allocation. It is used for the small state update
+/// carried by an ordered task.
+class TaskUpdate {
+    static constexpr std::size_t CAPACITY = 48;
+    typename std::aligned_storage<CAPACITY>::type storage;
+    void (*invoke)(void *, OrderedTask &) = nullptr;
+    void (*destroy)(void *) = nullptr;
+
+ public:
+    TaskUpdate() = default;
+    TaskUpdate(const TaskUpdate &) = delete;
+    TaskUpdate &operator=(const TaskUpdate &) = delete;
+    ~TaskUpdate() { reset(); }
+
+    /// Store the callable. It must fit in the inline storage.
+    template <typename F>
+    void emplace(F &&f) {
+        using Callable = typename std::decay<F>::type;
+        static_assert(sizeof(Callable) <= CAPACITY,
+                      "The state update of the task is too large.");
+        static_assert(alignof(Callable) <= alignof(decltype(storage)),
+                      "The state update of the task is over-aligned.");
+        reset();
+        new (&storage) Callable(std::forward<F>(f));
+        invoke = [](void *p, OrderedTask &task) {
+            (*static_cast<Callable *>(p))(task);
+        };
+        destroy = [](void *p) {
+            static_cast<Callable *>(p)->~Callable();
+        };
+    }
+
+    /// Destroy the stored callable, if any.
+    void reset() {
+        if (destroy != nullptr) {
+            destroy(&storage);
+        }
+        invoke = nullptr;
+        destroy = nullptr;
+    }
+
+    explicit operator bool() const { return invoke != nullptr; }
+
+    void operator()(OrderedTask &task) { invoke(&storage, task); }
+};
+
+class TaskPool;
+
+/// An output task to be executed in the order of its sequence number. The
+/// in-order executor first writes `error` to stderr and `output` to the
+/// output file, then runs `update` if it is set. Anything that does not
+/// depend on the states shared across packets should be formatted into
+/// `output` by the extractor. `update` reads and modifies the shared
+/// states, and may write more output based on them. `payload` is a scratch
+/// buffer for passing text to `update`. Lines mixing constant text with the
+/// shared states should also be formatted into `payload` by the extractor,
+/// leaving holes for the states, so that `update` only splices the
+/// segments of `payload` and the states together. The formatting then
+/// scales with the number of extractors, rather than running on the
+/// executor.
+///
+/// Tasks are recycled by the pool of the thread that acquired them, so
+/// their buffers keep the capacity across uses.
 struct OrderedTask {
-    long seq_num;
-    std::function<void()> func;
-    friend bool operator>(const OrderedTask &lhs, const OrderedTask &rhs);
+    std::string output;
+    std::string error;
+    std::string payload;
+    TaskUpdate update;
+    /// The index of the output stream in fanout mode.
+    int stream_index;
+    /// The pool that owns the task.
+    TaskPool *pool;
+    /// The link in the chain of its batch, or in the free list of the pool.
+    OrderedTask *next;
 };
 
-inline bool operator>(const OrderedTask &lhs, const OrderedTask &rhs) {
-    return lhs.seq_num > rhs.seq_num;
-}
+/// Get an empty task from the pool of the calling thread.
+extern OrderedTask *acquire_ordered_task();
+
+/// Start collecting the tasks of a batch on the calling thread. The batch
+/// covers the sequence numbers in [first_seq_num, end_seq_num), and each of
+/// them must be provided by `insert_ordered_task` before the batch ends.
+/// Note that the producer to this module MUST guarantee that the batch
+/// numbers are consecutive.
+extern void begin_ordered_batch(long batch_num, long first_seq_num,
+                                long end_seq_num);
 
-/// Provide a task associated with a sequence number to the in-order
-/// executor. Note that the producer to this module MUST guarantee that the
+/// Add a task associated with a sequence number to the batch of the calling
+/// thread. Note that the producer to this module MUST guarantee that the
 /// provided sequence number is consecutive.
-extern void insert_ordered_task(long seq_num, std::function<void()> func);
+extern void insert_ordered_task(long seq_num, OrderedTask *task);
+
+/// Provide a sequence number which has nothing to be executed.
+extern void insert_ordered_task(long seq_num);
+
+/// Provide the tasks of the batch collected on the calling thread to the
+/// in-order executor. This function may block if the batch is too far
+/// ahead of the one being executed.
+extern void end_ordered_batch();
+
+/// Return true if some producer is waiting for the in-order executor to
+/// catch up, i.e. the executor is the bottleneck.
+extern bool is_executor_backlogged();
+
+/// Return true if the batch is within half of the horizon of the in-order
+/// executor, so that it will be admitted without waiting, whatever the
+/// other producers do.
+extern bool is_batch_near_executor(long batch_num);
+
+/// Let the producers write the output to the file descriptor themselves,
+/// each task at the offset given by the sizes of the output of all tasks
+/// before it, instead of having the executor copy it to the output stream.
+/// The file descriptor must be accepted by `is_positionable_output`, and no
+/// task may carry a state update. It must be called before the executor
+/// starts.
+extern void enable_positioned_output(int fd);
 
 /// Kill the in-order executor prematurely. Note that the thread is not
 /// joined in this function. One should call `join_in_order_executor`
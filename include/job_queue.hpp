@@ -0,0 +1,109 @@
+/* Copyright [2020] Zhiyao Ma */
+#ifndef JOB_QUEUE_HPP_
+#define JOB_QUEUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include "cache_aligned.hpp"
+
+/// A bounded multi-producer multi-consumer queue by Dmitry Vyukov. Each
+/// cell carries a sequence number telling whether it is ready to be
+/// written or read in the current lap, so that producers and consumers
+/// only contend on a single CAS of their own position counter. The two
+/// counters sit on their own cache lines, also when the queue is on the
+/// heap.
+template <typename T>
+class MPMCQueue : public CacheAligned {
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> buffer;
+    std::size_t mask;
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> enqueue_pos;
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> dequeue_pos;
+
+ public:
+    /// The capacity is rounded up to a power of 2.
+    explicit MPMCQueue(std::size_t min_capacity) {
+        std::size_t capacity = 2;
+        while (capacity < min_capacity) {
+            capacity <<= 1;
+        }
+        buffer.reset(new Cell[capacity]);
+        mask = capacity - 1;
+        for (std::size_t i = 0; i < capacity; ++i) {
+            buffer[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueue_pos.store(0, std::memory_order_relaxed);
+        dequeue_pos.store(0, std::memory_order_relaxed);
+    }
+
+    /// Push an element. Return false without moving from `data` if the
+    /// queue is full.
+    bool try_push(T &&data) {
+        Cell *cell;
+        auto pos = enqueue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &buffer[pos & mask];
+            auto seq = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq)
+                      - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(data);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Pop an element. Return false if the queue is empty.
+    bool try_pop(T &data) {
+        Cell *cell;
+        auto pos = dequeue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &buffer[pos & mask];
+            auto seq = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq)
+                      - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        data = std::move(cell->data);
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// The number of elements in the queue. It is exact only if no other
+    /// thread is pushing or popping at the same time.
+    std::size_t size() const {
+        auto tail = enqueue_pos.load(std::memory_order_seq_cst);
+        auto head = dequeue_pos.load(std::memory_order_seq_cst);
+        return tail > head ? tail - head : 0;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+};
+
+#endif  // JOB_QUEUE_HPP_
@@ -0,0 +1,57 @@
+/* Copyright [2020] Zhiyao Ma */
+#ifndef LOSER_TREE_HPP_
+#define LOSER_TREE_HPP_
+
+#include <utility>
+#include <vector>
+
+/// A tree of losers for merging `k` sorted sources. Each internal node keeps
+/// the source that lost the match played there, and the overall winner is
+/// kept apart, so that replacing the winner by the next element of its
+/// source only replays the matches on the path from its leaf to the root,
+/// with one comparison per level.
+///
+/// `Less(i, j)` tells whether the current element of source `i` goes before
+/// that of source `j`. An exhausted source must go after every other one.
+template <typename Less>
+class LoserTree {
+    int k;
+    Less less;
+    /// `nodes[n]` is the loser at internal node `n`, for n in [1, k).
+    std::vector<int> nodes;
+    int winner_index;
+
+ public:
+    LoserTree(int k_, Less less_) : k(k_), less(std::move(less_)), nodes(k_) {
+        // Play all matches bottom-up. The leaf of source `i` is `k + i`.
+        std::vector<int> winners(2 * k);
+        for (int i = 0; i < k; ++i) {
+            winners[k + i] = i;
+        }
+        for (int n = k - 1; n >= 1; --n) {
+            auto lhs = winners[2 * n], rhs = winners[2 * n + 1];
+            if (less(rhs, lhs)) {
+                std::swap(lhs, rhs);
+            }
+            winners[n] = lhs;
+            nodes[n] = rhs;
+        }
+        winner_index = k <= 1 ? 0 : winners[1];
+    }
+
+    /// The source whose current element goes first.
+    int winner() const { return winner_index; }
+
+    /// Replay the matches after the winner has moved to its next element.
+    void replay() {
+        auto winner = winner_index;
+        for (int n = (k + winner_index) / 2; n >= 1; n /= 2) {
+            if (less(nodes[n], winner)) {
+                std::swap(nodes[n], winner);
+            }
+        }
+        winner_index = winner;
+    }
+};
+
+#endif  // LOSER_TREE_HPP_
@@ -0,0 +1,19 @@
+/* Copyright [2020] Zhiyao Ma */
+#ifndef LZ4_BLOCK_HPP_
+#define LZ4_BLOCK_HPP_
+
+#include <cstddef>
+#include <string>
+
+/// Compress the data into `dst` in the LZ4 block format. `dst` is
+/// overwritten. The original size is not recorded, so it must be kept by
+/// the caller.
+extern void compress_lz4_block(const char *src, std::size_t size,
+                               std::string &dst);
+
+/// Decompress the data in the LZ4 block format into `dst`, which must have
+/// room for exactly `original_size` bytes.
+extern void decompress_lz4_block(const char *src, std::size_t size,
+                                 char *dst, std::size_t original_size);
+
+#endif  // LZ4_BLOCK_HPP_
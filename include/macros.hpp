@@ -11,4 +11,10 @@
 #define if_likely(x)      if (__builtin_expect(static_cast<bool>(x), true))
 #define if_unlikely(x)    if (__builtin_expect(static_cast<bool>(x), false))
 
+#if defined(__x86_64__) || defined(__i386__)
+#define cpu_relax()       __builtin_ia32_pause()
+#else
+#define cpu_relax()       do {} while (0)
+#endif
+
 #endif  // MACROS_HPP_
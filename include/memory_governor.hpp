@@ -0,0 +1,56 @@
+/* Copyright [2020] Zhiyao Ma */
+#ifndef MEMORY_GOVERNOR_HPP_
+#define MEMORY_GOVERNOR_HPP_
+
+#include <atomic>
+#include <cstddef>
+
+/// The buffering points whose memory is accounted by the memory governor.
+enum class MemoryUse {
+    /// Jobs produced by the splitter and not yet finished by an extractor.
+    Jobs,
+    /// Tasks provided to the in-order executor and not yet executed.
+    Tasks,
+    /// Packets held in the reorder window.
+    ReorderWindow,
+    /// Packets held in the runs of the sort mode that are not spilled yet.
+    SortRuns,
+    /// Buffers of the output streams and the output writer.
+    OutputBuffers,
+    /// Hashes of the packet texts held by the duplicate filter.
+    DuplicateFilter,
+    NumberOfUses
+};
+
+/// Set the memory budget in bytes. 0 means unlimited, in which case no
+/// memory is accounted at all.
+extern void set_memory_budget(std::size_t budget);
+
+/// Return true if a memory budget is set.
+extern bool is_memory_limited();
+
+/// Account the memory without waiting.
+extern void charge_memory(MemoryUse use, std::size_t bytes);
+
+/// Give back the memory accounted by `charge_memory`. It wakes up the
+/// threads waiting for memory.
+extern void release_memory(MemoryUse use, std::size_t bytes);
+
+/// Return true if the accounted memory exceeds the budget.
+extern bool is_memory_exhausted();
+
+/// Return the memory accounted for the given use.
+extern std::size_t get_memory_usage(MemoryUse use);
+
+/// Wait until a new job of `bytes` fits in the budget, and account it.
+/// It does not wait if there is no job or task in flight, since waiting
+/// could not free any memory then. Return false without accounting if
+/// `early_terminating` is set.
+extern bool charge_job_memory(std::size_t bytes,
+                              const std::atomic<bool> &early_terminating);
+
+/// Wake up the threads waiting in `charge_job_memory`, so that they notice
+/// the termination.
+extern void wake_memory_waiters();
+
+#endif  // MEMORY_GOVERNOR_HPP_
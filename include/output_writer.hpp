@@ -0,0 +1,84 @@
+/* Copyright [2020] Zhiyao Ma */
+#ifndef OUTPUT_WRITER_HPP_
+#define OUTPUT_WRITER_HPP_
+
+#include <cstddef>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+/// A stream buffer which collects the output in large buffers and hands
+/// the full ones to the output writer thread. Only one thread may write
+/// to it at a time.
+class OutputBuffer : public std::streambuf {
+    /// The file descriptor the output goes to.
+    int fd;
+    /// Whether the file descriptor is closed on destruction.
+    bool owns_fd;
+
+    /// Hand the current buffer, if not empty, to the writer thread.
+    void submit();
+
+ protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char *s, std::streamsize n) override;
+    int sync() override;
+
+ public:
+    OutputBuffer(int fd_, bool owns_fd_);
+    ~OutputBuffer() override;
+    OutputBuffer(const OutputBuffer &) = delete;
+    OutputBuffer &operator=(const OutputBuffer &) = delete;
+
+    /// Return true if some output has not been handed to the writer yet.
+    bool is_dirty() const { return pptr() != pbase(); }
+
+    /// Return the file descriptor the output goes to.
+    int file_descriptor() const { return fd; }
+};
+
+/// An output stream writing to a file descriptor through an `OutputBuffer`.
+/// Flushing the stream, including by `std::endl`, hands the buffered output
+/// to the writer thread, so one should write '\n' instead.
+class OutputStream : public std::ostream {
+    OutputBuffer buffer;
+
+ public:
+    OutputStream(int fd, bool owns_fd);
+
+    /// Return the file descriptor the output goes to.
+    int file_descriptor() const { return buffer.file_descriptor(); }
+};
+
+/// Open the file for writing, truncating it. Return nullptr on failure.
+extern OutputStream *open_output_stream(const std::string &file_name);
+
+/// Return true if the output may be written to the file descriptor at
+/// given offsets, by `write_output_at`. It must be a regular file, not
+/// opened for appending, and not shared with stderr.
+extern bool is_positionable_output(int fd);
+
+/// Write the data to the file descriptor at the offset, retrying on partial
+/// writes, without moving the file offset.
+extern void write_output_at(int fd, const char *data, std::size_t size,
+                            long offset);
+
+/// Start the output writer thread.
+extern void start_output_writer();
+
+/// Hand the buffered output of all streams to the writer thread, wait until
+/// it is written, and join the writer thread. If writing has failed, the
+/// exception is rethrown here unless it has been thrown to a writer already.
+extern void stop_output_writer();
+
+/// Hand the buffered output of all streams to the writer thread.
+extern void flush_output();
+
+/// Flush all streams if they have not been flushed for
+/// `OUTPUT_FLUSH_INTERVAL_MS` milliseconds.
+extern void flush_output_if_stale();
+
+/// Return true if any stream holds output not handed to the writer yet.
+extern bool is_output_pending();
+
+#endif  // OUTPUT_WRITER_HPP_
@@ -2,6 +2,8 @@
 #ifndef PARAMETERS_HPP_
 #define PARAMETERS_HPP_
 
+#include <cstddef>
+
 /// Extractor thread number limit.
 constexpr int THREAD_LIMIT = 256;
 
@@ -9,24 +11,157 @@ constexpr int THREAD_LIMIT = 256;
 constexpr int THREAD_DEFAULT = 4;
 
 /// The full water mark for the queue between the splitter and the extractors.
-/// `FULL_WATRE_MARK * g_thread_num` is the maximum job number that can be
-/// buffered in the queue. If it reaches that value, the splitter will be
-/// temporarily blocked.
-constexpr int FULL_WATRE_MARK = 128;
+/// `FULL_WATRE_MARK` times the number of active extractors, which is
+/// `g_thread_num` unless it is tuned at run time, is the maximum number of
+/// job batches that can be buffered in the queue. If it reaches that value,
+/// the splitter will be temporarily blocked.
+constexpr int FULL_WATRE_MARK = 16;
 
 /// The middle water mark for the queue between the spitter and the extractors.
-/// `MIDDLE_WATER_MARK * g_thread_num` is the threshold for deciding whether
-/// the producing speed of the splitter or the consuming speed of the
-/// extractors is larger.
-constexpr int MIDDLE_WATER_MARK = 32;
+/// `MIDDLE_WATER_MARK` times the number of active extractors is the
+/// threshold for deciding whether the producing speed of the splitter or the
+/// consuming speed of the extractors is larger.
+constexpr int MIDDLE_WATER_MARK = 4;
 
 /// The low water mark for the queue between the splitter and the extractors.
-/// When the number of pending jobs in the queue drops below
-/// `LOW_WATER_MARK * g_thread_num`, the splitter thread will be notified
-/// to resume running.
-constexpr int LOW_WATER_MARK = 8;
+/// When the number of pending job batches in the queue drops below
+/// `LOW_WATER_MARK` times the number of active extractors, the splitter
+/// thread will be notified to resume running.
+constexpr int LOW_WATER_MARK = 1;
+
+/// The number of times a thread polls the job queue before it parks on the
+/// condition variable, either waiting for a job or for a free slot.
+constexpr int SPIN_BEFORE_PARK = 256;
+
+/// The interval in milliseconds at which the number of active extractors is
+/// retuned in the adaptive mode.
+constexpr long ADAPTIVE_THREAD_INTERVAL_MS = 20;
+
+/// The total XML text size at which the splitter closes a job batch. A
+/// batch is closed earlier if some extractor is idle, so that a slow input
+/// does not hold back the packets already read.
+constexpr std::size_t JOB_BATCH_SIZE = 32768;
+
+/// The total XML text size from which a batch is closed early for an idle
+/// extractor. Smaller batches are only closed early after they have been
+/// open for `JOB_BATCH_MAX_DELAY_US`, so that a splitter which cannot keep
+/// the extractors busy does not hand them one packet at a time.
+constexpr std::size_t JOB_BATCH_MIN_SIZE = 4096;
+
+/// The time in microseconds after which a batch is closed early for an idle
+/// extractor, however small it is.
+constexpr long JOB_BATCH_MAX_DELAY_US = 1000;
+
+/// The total XML text size from which a job batch is considered expensive.
+/// Such a batch holds a packet much larger than `JOB_BATCH_SIZE`, and is
+/// handed to the extractors ahead of the cheaper ones waiting in the queue.
+constexpr std::size_t EXPENSIVE_BATCH_SIZE = 4 * JOB_BATCH_SIZE;
+
+/// The capacity of the queue for expensive job batches, per extractor
+/// thread. When it is full, expensive batches go to the normal queue.
+constexpr int EXPRESS_QUEUE_SIZE = 1;
+
+/// The number of consecutive job batches an extractor moves from the job
+/// queue to its own work stealing deque at a time. Consecutive jobs
+/// processed by the same thread keep its cache warm, while idle threads may
+/// still steal them one batch at a time.
+constexpr int WORK_STEALING_BATCH = 2;
+
+/// The number of finished job batches each extractor may leave pending in
+/// the in-order executor. `REORDER_HORIZON_PER_THREAD * g_thread_num` is
+/// the largest distance between the sequence number of a batch being
+/// provided and the next batch to be executed. An extractor whose batch is
+/// beyond that horizon is blocked, so the memory held by pending tasks
+/// stays bounded even when a single slow packet holds back the executor.
+constexpr long REORDER_HORIZON_PER_THREAD = 32;
+
+/// The longest string capacity a recycled task keeps. Larger buffers left
+/// by huge packets are released when the task is reused.
+constexpr std::size_t TASK_BUFFER_KEEP_SIZE = 65536;
+
+/// An arena of the reorder window is released on compaction if its capacity
+/// exceeds `REORDER_ARENA_SLACK_FACTOR` times the texts left in the window
+/// plus `REORDER_ARENA_KEEP_SIZE`, so that a burst of large or numerous
+/// packets does not pin its peak memory.
+constexpr std::size_t REORDER_ARENA_SLACK_FACTOR = 4;
+constexpr std::size_t REORDER_ARENA_KEEP_SIZE = std::size_t(1) << 20;
+
+/// The total XML text size of the packets each input may read ahead of the
+/// merge in the merge mode.
+constexpr std::size_t MERGE_READ_AHEAD_SIZE = 1 << 20;
+
+/// The interval in milliseconds at which a reader of the merge mode waiting
+/// on its input checks whether it should stop.
+constexpr int INPUT_POLL_INTERVAL_MS = 100;
 
 /// The size of the buffer to read input characters.
 constexpr int READ_BUFF_SIZE = 16384;
 
+/// The number of slots in the table memoizing the match decision of each
+/// packet type in the filter mode. It must be a power of 2.
+constexpr int PACKET_TYPE_CACHE_SIZE = 1024;
+
+/// The size of each buffer collecting the output before it is handed to the
+/// output writer thread.
+constexpr int OUTPUT_BUFFER_SIZE = 4 << 20;
+
+/// The number of output buffers that may be waiting for the output writer
+/// thread, in addition to the one being filled by each stream. Writers
+/// block when all of them are in use.
+constexpr int OUTPUT_BUFFER_NUM = 8;
+
+/// The longest time in milliseconds the buffered output may be held back
+/// before it is handed to the output writer thread.
+constexpr int OUTPUT_FLUSH_INTERVAL_MS = 100;
+
+/// The memory held by a run of the sort mode before it is sorted and
+/// spilled to a temporary file, if no memory budget is set. Otherwise, a
+/// run takes `1 / SORT_RUN_BUDGET_SHARE` of the budget.
+constexpr std::size_t SORT_RUN_SIZE = std::size_t(256) << 20;
+constexpr std::size_t SORT_RUN_BUDGET_SHARE = 4;
+
+/// The number of runs of the sort mode that may be sorted and spilled in
+/// the background at a time, in addition to the one being filled.
+constexpr std::size_t SORT_SPILLING_RUN_NUM = 2;
+
+/// The largest number of runs of the sort mode merged at a time. More runs
+/// are merged in several passes.
+constexpr std::size_t SORT_MERGE_FAN_IN = 64;
+
+/// The size of the buffer of each temporary file of the sort mode. A buffer
+/// is only held while its file is written or read.
+constexpr std::size_t SORT_FILE_BUFFER_SIZE = 1 << 20;
+
+/// The file descriptors kept free for the inputs and the outputs when the
+/// sort mode bounds the number of temporary files open at once.
+constexpr std::size_t SORT_RESERVED_FD_NUM = 64;
+
+/// The initial size in microseconds of the reorder window sized
+/// automatically, which holds until the disorder of the first epoch is
+/// known.
+constexpr long REORDER_AUTO_INITIAL_WINDOW = 1000000;
+
+/// The smallest size in microseconds of the reorder window sized
+/// automatically.
+constexpr long REORDER_AUTO_MIN_WINDOW = 1000;
+
+/// The reorder window sized automatically is `REORDER_AUTO_SAFETY_FACTOR`
+/// times the largest inversion distance of the current and the last epoch,
+/// each spanning `REORDER_AUTO_EPOCH` microseconds of the timestamps.
+constexpr long REORDER_AUTO_SAFETY_FACTOR = 2;
+constexpr long REORDER_AUTO_EPOCH = 10000000;
+
+/// The memory the reorder window sized automatically may hold, if no memory
+/// budget is set. Otherwise, it takes `1 / REORDER_AUTO_BUDGET_SHARE` of
+/// the budget.
+constexpr std::size_t REORDER_AUTO_MEMORY_CAP = std::size_t(256) << 20;
+constexpr std::size_t REORDER_AUTO_BUDGET_SHARE = 4;
+
+/// The initial number of slots of the hash table of the duplicate filter.
+/// It must be a power of 2.
+constexpr std::size_t DUPLICATE_FILTER_INITIAL_SIZE = 4096;
+
+/// The smallest memory budget accepted by --max-memory.
+constexpr std::size_t MIN_MEMORY_BUDGET = std::size_t(64) << 20;
+
 #endif  // PARAMETERS_HPP_
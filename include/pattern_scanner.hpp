@@ -0,0 +1,60 @@
+/* Copyright [2020] Zhiyao Ma */
+#ifndef PATTERN_SCANNER_HPP_
+#define PATTERN_SCANNER_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// The result of a scan. It records where each pattern first occurs.
+struct PatternMatches {
+    /// Whether the scan has been performed.
+    bool scanned = false;
+    /// The offset of the first occurrence of each pattern, indexed by the
+    /// pattern id. It is `std::string::npos` if the pattern is absent.
+    std::vector<std::size_t> positions;
+
+    bool found(int pattern_id) const {
+        return positions[pattern_id] != std::string::npos;
+    }
+
+    std::size_t position(int pattern_id) const {
+        return positions[pattern_id];
+    }
+};
+
+/// A multi-substring scanner implemented with the Aho-Corasick automaton.
+/// It finds all registered patterns in one pass over the text.
+class PatternScanner {
+    /// The transition table of the automaton, `ALPHABET_SIZE` entries for
+    /// each state. State 0 is the root.
+    std::vector<int32_t> delta;
+    /// The ids of the patterns ending at each state, including those
+    /// reachable by following the failure links.
+    std::vector<std::vector<int>> outputs;
+    /// The length of each pattern.
+    std::vector<std::size_t> lengths;
+    static constexpr int ALPHABET_SIZE = 256;
+ public:
+    explicit PatternScanner(const std::vector<std::string> &patterns);
+
+    /// Scan the text into `matches`, reusing the memory it holds, so that
+    /// the caller may keep one result across many scans.
+    void scan(const char *text, std::size_t len,
+              PatternMatches &matches) const;
+    void scan(const std::string &text, PatternMatches &matches) const {
+        scan(text.data(), text.size(), matches);
+    }
+};
+
+/// Register a pattern to be searched by the shared scanner, and return its
+/// id. Registering the same string again returns the same id. It must be
+/// called before the first call to `shared_pattern_scanner`, typically to
+/// initialize a static variable of the module that uses the pattern.
+extern int register_scan_pattern(const std::string &pattern);
+
+/// Return the scanner searching for all registered patterns in one pass.
+/// It is built on the first call, after which no pattern may be registered.
+extern const PatternScanner &shared_pattern_scanner();
+
+#endif  // PATTERN_SCANNER_HPP_
@@ -2,17 +2,134 @@
 #ifndef SORTER_HPP_
 #define SORTER_HPP_
 
-#include <map>
+#include <cstddef>
 #include <ctime>
+#include <limits>
 #include <string>
+#include <vector>
 
 /// A packet sorter.
 class ReorderWindow {
+    /// A packet in the window. Its text is kept in `arena`, possibly
+    /// compressed, or left in the input file if `file_idx` is not negative.
+    /// In the deduplicate mode, its timestamp text follows in `arena`.
+    struct Entry {
+        time_t timestamp;
+        /// The arrival order, which breaks ties of timestamps.
+        long seq_num;
+        /// The offset of the text in `arena`, or in the input file.
+        long offset;
+        std::size_t size;
+        /// The size of the compressed text in `arena`, or 0 if the text is
+        /// not compressed.
+        std::size_t packed_size;
+        /// The offset of the timestamp text in `arena`.
+        long ts_offset;
+        std::size_t ts_size;
+        int file_idx;
+
+        /// The size of the text in `arena`.
+        std::size_t stored_size() const {
+            return file_idx >= 0 ? 0
+                   : packed_size > 0 ? packed_size : size;
+        }
+    };
+
     time_t ooo_tolerance;
-    std::multimap<time_t, std::string> window;
+    /// The binary heap of the packets, with the oldest one on top.
+    std::vector<Entry> heap;
+    /// The texts of the packets, one after another.
+    std::string arena;
+    /// The spare buffer to compact `arena` into.
+    std::string spare_arena;
+    /// The total size of the texts in `arena` already sent to the output.
+    std::size_t dead_size = 0;
+    long next_seq_num = 0;
+    /// The newest timestamp in the window.
+    time_t largest_time = 0;
+    /// The file descriptors of the input files, indexed by `file_idx`, to
+    /// read the texts left there.
+    std::vector<int> input_fds;
+    /// The buffer to read a text from an input file, or to decompress it.
+    std::string read_buffer;
+    /// Whether the texts are compressed by the extractors.
+    bool compressing = false;
+    /// Whether the packets older than one already sent to the output are
+    /// dropped, as in the deduplicate mode.
+    bool deduplicating = false;
+    /// Whether the window size follows the disorder of the input.
+    bool auto_sizing = false;
+    /// The memory the window may hold before it evicts packets within its
+    /// size, when it is sized automatically.
+    std::size_t memory_cap = std::numeric_limits<std::size_t>::max();
+    /// The memory accounted for the packets in the window.
+    std::size_t held_size = 0;
+    /// The newest timestamp when the current epoch of the automatic sizing
+    /// started.
+    time_t epoch_start = 0;
+    /// The largest inversion distance of the packets inserted in the
+    /// current and the last epoch.
+    time_t epoch_inversion = 0;
+    time_t last_epoch_inversion = 0;
+    time_t largest_inversion = 0;
+    /// The timestamp of the last packet sent to the output.
+    time_t last_output_time = std::numeric_limits<time_t>::min();
+    /// The number of packets sent to the output after a newer one.
+    long late_packet_num = 0;
+
+    void push(Entry entry, const std::string &record);
+    void pop();
+    void compact();
+    void retune(time_t timestamp);
  public:
     explicit ReorderWindow(time_t ooo_tolerance_);
-    void update(time_t timestamp, std::string &&str);
+    ~ReorderWindow();
+    ReorderWindow(const ReorderWindow &) = delete;
+    ReorderWindow &operator=(const ReorderWindow &) = delete;
+
+    /// Take over the file descriptors of the input files, which must be
+    /// regular files, so that the window may keep only the offsets of the
+    /// packets and read their texts again on eviction.
+    void reference_inputs(std::vector<int> fds);
+
+    /// Return true if the window reads the texts from the input files.
+    bool is_referencing_inputs() const { return !input_fds.empty(); }
+
+    /// Let the extractors compress the texts kept in the window.
+    void enable_compression() { compressing = true; }
+
+    /// Return true if the texts kept in the window should be compressed.
+    bool is_compressing() const { return compressing; }
+
+    /// Let the window size follow the disorder of the input, starting from
+    /// the size given to the constructor. The window holds at most
+    /// `memory_cap_` bytes of packets, evicting the oldest ones beyond.
+    void enable_auto_size(std::size_t memory_cap_);
+
+    /// Drop the packets leaving the window whose timestamps are older than
+    /// that of a packet already sent to the output, as the deduplicate mode
+    /// does on the output of the window. The extractors must then provide
+    /// the timestamp text of each packet after the rest of its record.
+    void enable_deduplication() { deduplicating = true; }
+
+    /// Return true if the packets leaving the window are deduplicated.
+    bool is_deduplicating() const { return deduplicating; }
+
+    /// Insert a packet. The last `ts_size` bytes of `record` are its
+    /// timestamp text, and the rest is its text.
+    void update(time_t timestamp, std::string &&record,
+                std::size_t ts_size);
+
+    /// Insert a packet whose text is compressed by `compress_lz4_block`
+    /// from `size` bytes. The last `ts_size` bytes of `record` are its
+    /// timestamp text, and the rest is the compressed text.
+    void update(time_t timestamp, std::string &&record, std::size_t size,
+                std::size_t ts_size);
+
+    /// Insert a packet whose text is left in the input file, at `offset`
+    /// with `size` bytes. `record` holds its timestamp text, if any.
+    void update(time_t timestamp, int file_idx, long offset,
+                std::size_t size, std::string &&record);
     void flush();
 };
 
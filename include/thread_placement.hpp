@@ -0,0 +1,40 @@
+/* Copyright [2020] Zhiyao Ma */
+#ifndef THREAD_PLACEMENT_HPP_
+#define THREAD_PLACEMENT_HPP_
+
+#include <string>
+#include <vector>
+
+/// The roles of the threads in the pipeline.
+enum class ThreadRole {
+    Splitter,
+    Extractor,
+    InOrderExecutor,
+    OutputWriter
+};
+
+/// Parse a CPU list like "0-3,8,10-11". The CPUs are returned in the order
+/// given, without duplicates.
+extern std::vector<int> parse_cpu_list(const std::string &str);
+
+/// Return the CPUs the process is allowed to run on.
+extern std::vector<int> get_available_cpus();
+
+/// Return the number of CPUs the process may keep busy, which is limited
+/// by both the CPU affinity and the CPU quota of the cgroup.
+extern int get_usable_cpu_num();
+
+/// Plan the placement of the pipeline threads on the given CPUs, with
+/// `extractor_num` extractor threads. Without a plan, threads are not
+/// pinned at all.
+extern void set_thread_placement(const std::vector<int> &cpus,
+                                 int extractor_num);
+
+/// Pin the calling thread to the CPUs planned for its role. `index` is the
+/// worker id of an extractor. It does nothing if no placement is planned.
+extern void pin_current_thread(ThreadRole role, int index = 0);
+
+/// Describe the planned placement, one role per line.
+extern std::string describe_thread_placement();
+
+#endif  // THREAD_PLACEMENT_HPP_
@@ -0,0 +1,33 @@
+/* Copyright [2020] Zhiyao Ma */
+#ifndef TYPE_FILTER_HPP_
+#define TYPE_FILTER_HPP_
+
+#include <atomic>
+#include <memory>
+#include <regex>
+#include <string>
+
+/// A packet type matcher. It memoizes the match decision of the regular
+/// expression for each distinct packet type string.
+class PacketTypeFilter {
+    /// A slot in the open addressing hash table. The index of the slot is
+    /// the interned id of the packet type stored in it.
+    struct Slot {
+        /// One of `EMPTY`, `WRITING` and `READY`.
+        std::atomic<int> state;
+        std::size_t hash;
+        std::string type;
+        bool matched;
+    };
+    static constexpr int EMPTY = 0;
+    static constexpr int WRITING = 1;
+    static constexpr int READY = 2;
+
+    std::regex regex;
+    std::unique_ptr<Slot[]> slots;
+ public:
+    explicit PacketTypeFilter(const std::string &pattern);
+    bool match(const std::string &type);
+};
+
+#endif  // TYPE_FILTER_HPP_
@@ -0,0 +1,90 @@
+/* Copyright [2020] Zhiyao Ma */
+#ifndef WORK_STEALING_DEQUE_HPP_
+#define WORK_STEALING_DEQUE_HPP_
+
+#include <atomic>
+#include <memory>
+#include "cache_aligned.hpp"
+
+/// A fixed capacity Chase-Lev work stealing deque, following the C11
+/// formulation by Le et al. The owner thread pushes and pops at the
+/// bottom, while any other thread may steal from the top. `T` must be
+/// trivially copyable, since a thief may read a cell that is concurrently
+/// being reused by the owner and discard it afterwards. `top` and `bottom`
+/// sit on their own cache lines, also when the deque is on the heap.
+template <typename T>
+class WorkStealingDeque : public CacheAligned {
+    std::unique_ptr<std::atomic<T>[]> buffer;
+    long mask;
+    alignas(CACHE_LINE_SIZE) std::atomic<long> top;
+    alignas(CACHE_LINE_SIZE) std::atomic<long> bottom;
+
+ public:
+    /// The capacity is rounded up to a power of 2.
+    explicit WorkStealingDeque(long min_capacity) {
+        long capacity = 2;
+        while (capacity < min_capacity) {
+            capacity <<= 1;
+        }
+        buffer.reset(new std::atomic<T>[capacity]);
+        mask = capacity - 1;
+        top.store(0, std::memory_order_relaxed);
+        bottom.store(0, std::memory_order_relaxed);
+    }
+
+    /// Push an element at the bottom. Only the owner may call it. Return
+    /// false if the deque is full.
+    bool push(T x) {
+        auto b = bottom.load(std::memory_order_relaxed);
+        auto t = top.load(std::memory_order_acquire);
+        if (b - t > mask) {
+            return false;
+        }
+        buffer[b & mask].store(x, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /// Pop an element from the bottom. Only the owner may call it. Return
+    /// false if the deque is empty.
+    bool pop(T &x) {
+        auto b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        x = buffer[b & mask].load(std::memory_order_relaxed);
+        if (t == b) {
+            // The last element. Race against the thieves for it.
+            bool won = top.compare_exchange_strong(
+                t, t + 1,
+                std::memory_order_seq_cst, std::memory_order_relaxed
+            );
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    /// Steal an element from the top. Any thread may call it. Return false
+    /// if the deque is empty or another thread won the race.
+    bool steal(T &x) {
+        auto t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return false;
+        }
+        x = buffer[t & mask].load(std::memory_order_relaxed);
+        return top.compare_exchange_strong(
+            t, t + 1,
+            std::memory_order_seq_cst, std::memory_order_relaxed
+        );
+    }
+};
+
+#endif  // WORK_STEALING_DEQUE_HPP_
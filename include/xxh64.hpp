@@ -0,0 +1,12 @@
+/* Copyright [2020] Zhiyao Ma */
+#ifndef XXH64_HPP_
+#define XXH64_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+/// Hash the data with the 64-bit xxHash algorithm (XXH64) and seed 0. The
+/// result is the same as that of the reference implementation.
+extern std::uint64_t hash_xxh64(const char *data, std::size_t size);
+
+#endif  // XXH64_HPP_
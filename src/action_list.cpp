@@ -10,7 +10,8 @@
  * All `ConditionalAction`s are stored in a list. Note that ONLY THE FIRST
  * action function in the list whose corresponding predicate function yields
  * true will be called. All predicate and action functions after it will be
- * skipped.
+ * skipped. The only exception is the fanout mode of the extractors, where
+ * all actions whose predicate functions yield true will be called.
  * 
  * HOW TO ADD A NEW ACTION:
  * 1. Write a predicate function with signature
@@ -20,8 +21,10 @@
  * 3. Push them to `g_action_list` in the function `initialize_action_list`.
  *    Note that the last predicate function MUST yield true.
  * 4. Make sure that if you want to output anything in the action function,
- *    wrap it in the lambda and pass it to the in-order executor by calling
- *    `insert_ordered_task`. See `print_timestamp` for example.
+ *    format it into an `OrderedTask` got from `acquire_ordered_task`, and
+ *    pass it to the in-order executor by calling `insert_ordered_task`.
+ *    Anything that reads or modifies states shared across packets must be
+ *    done in the `update` of the task. See `print_timestamp` for example.
  */
 #include "action_list.hpp"
 #include "in_order_executor.hpp"
@@ -91,12 +94,12 @@ ActionList g_action_list;
 /// in-order executor module.
 void initialize_action_list_with_extractors() {
     // Below is an example.
-    // Predicate: find the "mobilityControlInfo is present" string recursively.
+    // Predicate: find the "mobilityControlInfo is present" string.
     // Action: print the timestamp of this packet.
     // g_action_list.push_back(
     //     {
     //         [](const pt::ptree &tree, const Job &job) {
-    //             return recursive_find_mobility_control_info(tree);
+    //             return is_mobility_control_info_present(job);
     //         },
     //         print_time_of_mobility_control_info
     //     }
@@ -123,6 +126,7 @@ void initialize_action_list_with_extractors() {
                     extract_rrc_ota_packet
                 }
             );
+            g_action_list.back().stateful = true;
             std::cerr << "Extractor enabled: "
                       << "LTE_RRC_OTA_Packet" << std::endl;
             break;
@@ -177,6 +181,7 @@ void initialize_action_list_with_extractors() {
                     update_pdcp_cipher_data_pdu_packet_timestamp
                 }
             );
+            g_action_list.back().stateful = true;
             std::cerr << "Compound extractor enabled: "
                       << "act on LTE_PDCP_UL_Cipher_Data_PDU "
                       << "and LTE_PDCP_DL_Cipher_Data_PDU"
@@ -235,6 +240,7 @@ void initialize_action_list_with_extractors() {
                     extract_lte_mac_rach_trigger_packet
                 }
             );
+            g_action_list.back().stateful = true;
             std::cerr << "Extractor enabled: "
                       << "LTE_MAC_Rach_Trigger" << std::endl;
             break;
@@ -358,6 +364,9 @@ void initialize_action_list_with_extractors() {
                 "is not exhaustive. Ran into default branch."
             );
         }
+        if (extractor != ExtractorEnum::NOP) {
+            g_action_list.back().name = i;
+        }
     }
 
     // Predicate: always true
@@ -366,7 +375,7 @@ void initialize_action_list_with_extractors() {
         {
             [](const pt::ptree &tree, const Job &job) { return true; },
             [](pt::ptree &&tree, Job &&job) {
-                insert_ordered_task(job.job_num, []{});
+                insert_ordered_task(job.job_num);
             }
         }
     );
@@ -384,16 +393,19 @@ void initialize_action_list_with_range() {
     );
 }
 
-/// Initialize the `g_action_list` to do the deduplicate work. Since the
-/// predicate function always return true, we do not need another dummy
-/// function at the end of the list.
+/// Initialize the `g_action_list` to do the deduplicate work, by the
+/// content of the packets if the duplicate filter is set, or by their
+/// timestamps otherwise. Since the predicate function always return true,
+/// we do not need another dummy function at the end of the list.
 void initialize_action_list_to_dedup() {
     g_action_list.push_back(
         {
             [](const pt::ptree &tree, const Job &job) { return true; },
-            echo_packet_if_new
+            g_duplicate_filter != nullptr ? echo_packet_if_unique
+                                          : echo_packet_if_new
         }
     );
+    g_action_list.back().stateful = true;
 }
 
 /// Initialize the `g_action_list` to do the reorder work. Since the
@@ -406,6 +418,35 @@ void initialize_action_list_to_reorder() {
             update_reorder_window
         }
     );
+    g_action_list.back().stateful = true;
+}
+
+/// Initialize the `g_action_list` to do the sort work. Since the
+/// predicate function always return true, we do not need another dummy
+/// function at the end of the list.
+void initialize_action_list_to_sort() {
+    g_action_list.push_back(
+        {
+            [](const pt::ptree &tree, const Job &job) { return true; },
+            add_packet_to_external_sorter
+        }
+    );
+    g_action_list.back().stateful = true;
+    g_action_list.back().needs_tree = false;
+}
+
+/// Initialize the `g_action_list` to profile the disorder of the packet
+/// timestamps. Since the predicate function always return true, we do not
+/// need another dummy function at the end of the list.
+void initialize_action_list_to_profile_disorder() {
+    g_action_list.push_back(
+        {
+            [](const pt::ptree &tree, const Job &job) { return true; },
+            profile_packet_disorder
+        }
+    );
+    g_action_list.back().stateful = true;
+    g_action_list.back().needs_tree = false;
 }
 
 /// Initialize the `g_action_list` to do the filter work. Since the
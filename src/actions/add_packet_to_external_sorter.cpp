@@ -0,0 +1,22 @@
+/* Copyright [2020] Zhiyao Ma */
+#include "macros.hpp"
+#include "actions.hpp"
+#include "global_states.hpp"
+#include "in_order_executor.hpp"
+
+void add_packet_to_external_sorter(pt::ptree &&tree, Job &&job) {
+    auto &&timestamp = scan_packet_timestamp_text(job.xml_string);
+
+    auto rawtime = timestamp_str2long_microsec_hack(timestamp);
+    if_unlikely (rawtime == static_cast<time_t>(-1)) {
+        drop_packet_with_invalid_timestamp(job.job_num, timestamp);
+        return;
+    }
+
+    auto task = acquire_ordered_task();
+    task->payload.swap(job.xml_string);
+    task->update.emplace([rawtime](OrderedTask &task) {
+        g_external_sorter->update(rawtime, std::move(task.payload));
+    });
+    insert_ordered_task(job.job_num, task);
+}
@@ -11,32 +11,27 @@ void echo_packet_if_new(pt::ptree &&tree, Job &&job) {
 
     auto rawtime = timestamp_str2long_microsec_hack(timestamp);
     if_unlikely (rawtime == static_cast<time_t>(-1)) {
-        insert_ordered_task(
-            job.job_num,
-            [timestamp = std::move(timestamp)] {
-                std::cerr << "Warning (packet timestamp = "
-                          + timestamp + "): \n"
-                          << "Timestamp does not match the pattern "
-                          << "\"%d-%d-%d %d:%d:%d.%d\" "
-                          << "or \"%d-%d-%d %d:%d:%d\". "
-                          << "Dropped." << std::endl;
-            }
-        );
+        drop_packet_with_invalid_timestamp(job.job_num, timestamp);
         return;
     }
 
-    insert_ordered_task(
-        job.job_num,
-        [content = std::move(job.xml_string), rawtime, timestamp] {
+    // Whether the packet is printed depends on the latest timestamp seen
+    // so far, so the decision is deferred to the in-order executor.
+    auto task = acquire_ordered_task();
+    task->payload.swap(job.xml_string);
+    task->payload += '\n';
+    task->update.emplace(
+        [rawtime, timestamp = std::move(timestamp)](OrderedTask &task) {
             if (rawtime >= g_latest_seen_timestamp) {
-                (*g_output) << content << std::endl;
+                g_output->write(task.payload.data(), task.payload.size());
                 g_latest_seen_timestamp = rawtime;
                 g_latest_seen_ts_string = timestamp;
             } else {
-                std::cerr << "Dropping packet: "
-                          << timestamp << " < "
-                          << g_latest_seen_ts_string << std::endl;
+                (*g_error_output) << "Dropping packet: "
+                                  << timestamp << " < "
+                                  << g_latest_seen_ts_string << '\n';
             }
         }
     );
+    insert_ordered_task(job.job_num, task);
 }
@@ -5,16 +5,12 @@
 
 void echo_packet_if_match(pt::ptree &&tree, Job &&job) {
     auto &&type = get_packet_type(tree);
-    if (std::regex_match(type, g_packet_type_regex)) {
-        insert_ordered_task(
-            job.job_num,
-            [result = std::move(job.xml_string)] {
-                (*g_output) << result << std::endl;
-            }
-        );
+    if (g_packet_type_filter->match(type)) {
+        auto task = acquire_ordered_task();
+        task->output.swap(job.xml_string);
+        task->output += '\n';
+        insert_ordered_task(job.job_num, task);
     } else {
-        insert_ordered_task(
-            job.job_num, []{}
-        );
+        insert_ordered_task(job.job_num);
     }
 }
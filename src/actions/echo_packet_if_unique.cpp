@@ -0,0 +1,35 @@
+/* Copyright [2020] Zhiyao Ma */
+#include "macros.hpp"
+#include "actions.hpp"
+#include "global_states.hpp"
+#include "in_order_executor.hpp"
+#include "xxh64.hpp"
+
+/// Print the packet to the output file unless a packet with the same text
+/// has been seen within the deduplicate horizon.
+void echo_packet_if_unique(pt::ptree &&tree, Job &&job) {
+    auto &&timestamp = get_packet_time_stamp(tree);
+
+    auto rawtime = timestamp_str2long_microsec_hack(timestamp);
+    if_unlikely (rawtime == static_cast<time_t>(-1)) {
+        drop_packet_with_invalid_timestamp(job.job_num, timestamp);
+        return;
+    }
+
+    // The text is hashed here, so that the executor only looks it up.
+    auto hash = hash_xxh64(job.xml_string.data(), job.xml_string.size());
+    auto task = acquire_ordered_task();
+    task->payload.swap(job.xml_string);
+    task->payload += '\n';
+    task->update.emplace(
+        [rawtime, hash, timestamp = std::move(timestamp)](OrderedTask &task) {
+            if (g_duplicate_filter->insert(rawtime, hash)) {
+                g_output->write(task.payload.data(), task.payload.size());
+            } else {
+                (*g_error_output) << "Dropping duplicate packet: "
+                                  << timestamp << '\n';
+            }
+        }
+    );
+    insert_ordered_task(job.job_num, task);
+}
@@ -12,15 +12,12 @@ void echo_packet_within_time_range(pt::ptree &&tree, Job &&job) {
 
     auto rawtime = timestamp_str2long(timestamp);
     if (rawtime == static_cast<time_t>(-1)) {
-        insert_ordered_task(
-            job.job_num,
-            [timestamp = std::move(timestamp)] {
-                std::cerr << "Warning (packet timestamp = "
-                          + timestamp + "): \n"
-                          << "Timestamp is not in the format "
-                          << "\"%d-%d-%d %d:%d:%d.%*d\"\n";
-            }
-        );
+        auto task = acquire_ordered_task();
+        task->error += "Warning (packet timestamp = ";
+        task->error += timestamp;
+        task->error += "): \nTimestamp is not in the format "
+                       "\"%d-%d-%d %d:%d:%d.%*d\"\n";
+        insert_ordered_task(job.job_num, task);
         return;
     }
 
@@ -32,15 +29,12 @@ void echo_packet_within_time_range(pt::ptree &&tree, Job &&job) {
         }
     }
 
-    std::string content;
     if (within_range) {
-        content = std::move(job.xml_string);
-        content += '\n';
+        auto task = acquire_ordered_task();
+        task->output.swap(job.xml_string);
+        task->output += '\n';
+        insert_ordered_task(job.job_num, task);
+    } else {
+        insert_ordered_task(job.job_num);
     }
-    insert_ordered_task(
-        job.job_num,
-        [content = std::move(content)] {
-            (*g_output) << content;
-        }
-    );
 }
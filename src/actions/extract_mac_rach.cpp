@@ -14,27 +14,27 @@
 void extract_mac_rach_attempt_packet(pt::ptree &&tree, Job &&job) {
     auto &&timestamp = get_packet_time_stamp(tree);
 
-    std::string results;
+    auto task = acquire_ordered_task();
+    auto &result = task->output;
+    result += timestamp;
+    result += " $ LTE_MAC_Rach_Attempt $ ";
     {
         auto &&rach_results = locate_subtree_with_attribute(
             tree, "key", "Rach result"
         );
+        bool first = true;
         for (auto ptr : rach_results) {
-            if (!results.empty()) {
-                results += ", ";
+            if (!first) {
+                result += ", ";
             }
-            results += "Result: " + ptr->data();
+            first = false;
+            result += "Result: ";
+            result += ptr->data();
         }
     }
+    result += '\n';
 
-    insert_ordered_task(
-        job.job_num,
-        [timestamp = std::move(timestamp),
-         results = std::move(results)] {
-            (*g_output) << timestamp << " $ LTE_MAC_Rach_Attempt $ "
-                        << results << std::endl;
-        }
-    );
+    insert_ordered_task(job.job_num, task);
 }
 
 /// This function extracts and prints triggering reason of ramdom access
@@ -49,28 +49,32 @@ void extract_lte_mac_rach_trigger_packet(
     pt::ptree &&tree, Job &&job) {
     auto &&timestamp = get_packet_time_stamp(tree);
 
-    std::string reasons;
+    auto task = acquire_ordered_task();
+    auto &result = task->output;
+    result += timestamp;
+    result += " $ LTE_MAC_Rach_Trigger $ ";
     {
         auto &&rach_results = locate_subtree_with_attribute(
             tree, "key", "Rach reason"
         );
+        bool first = true;
         for (auto ptr : rach_results) {
-            if (!reasons.empty()) {
-                reasons += ", ";
+            if (!first) {
+                result += ", ";
             }
-            reasons += "Reason: " + ptr->data();
+            first = false;
+            result += "Reason: ";
+            result += ptr->data();
         }
     }
+    result += ", LastPDCPPacketTimestamp: ";
 
-    insert_ordered_task(
-        job.job_num,
-        [timestamp = std::move(timestamp),
-         reasons = std::move(reasons)] {
-            (*g_output) << timestamp << " $ LTE_MAC_Rach_Trigger $ "
-                        << reasons
-                        << ", LastPDCPPacketTimestamp: "
-                        << g_last_pdcp_packet_timestamp
-                        << std::endl;
-        }
-    );
+    // The last PDCP timestamp is only known once all preceding packets
+    // have been executed, so it is appended by the in-order executor.
+    task->update.emplace([](OrderedTask &task) {
+        g_output->write(g_last_pdcp_packet_timestamp.data(),
+                        g_last_pdcp_packet_timestamp.size());
+        g_output->put('\n');
+    });
+    insert_ordered_task(job.job_num, task);
 }
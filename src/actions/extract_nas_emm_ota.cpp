@@ -3,6 +3,14 @@
 #include "global_states.hpp"
 #include "in_order_executor.hpp"
 
+/// The ids of the message types in the shared scanner.
+static const int TRACKING_AREA_UPDATE_ACCEPT =
+    register_scan_pattern("Tracking area update accept");
+static const int TRACKING_AREA_UPDATE_REJECT =
+    register_scan_pattern("Tracking area update reject");
+static const int TRACKING_AREA_UPDATE_REQUEST =
+    register_scan_pattern("Tracking area update request");
+
 /// This function extracts and prints tracking area update accept or reject
 /// from LTE_NAS_EMM_OTA_Incoming_Packet packets. For update accept, it
 /// looks for the pattern shown below.
@@ -14,6 +22,14 @@
 ///     ...
 /// </dm_log_packet>
 void extract_nas_emm_ota_incoming_packet(pt::ptree &&tree, Job &&job) {
+    // If neither string occurs anywhere in the raw packet, there is no
+    // need to walk the tree.
+    if (!is_pattern_present(job, TRACKING_AREA_UPDATE_ACCEPT)
+        && !is_pattern_present(job, TRACKING_AREA_UPDATE_REJECT)) {
+        insert_ordered_task(job.job_num);
+        return;
+    }
+
     std::string timestamp = get_packet_time_stamp(tree);
 
     bool tracking_area_update_accept = false;
@@ -21,13 +37,17 @@ void extract_nas_emm_ota_incoming_packet(pt::ptree &&tree, Job &&job) {
     auto &&nas_msg_emm_type_fields = locate_subtree_with_attribute(
         tree, "name", "nas_eps.nas_msg_emm_type"
     );
+    // The result is kept across the shownames and packets of the thread,
+    // so that the scans do not allocate.
+    static thread_local PatternMatches matches;
     for (auto ptr : nas_msg_emm_type_fields) {
         auto &&showname = ptr->get("<xmlattr>.showname", std::string());
-        if (showname.find("Tracking area update accept") != std::string::npos) {
+        shared_pattern_scanner().scan(showname, matches);
+        if (matches.found(TRACKING_AREA_UPDATE_ACCEPT)) {
             tracking_area_update_accept = true;
             break;
         }
-        if (showname.find("Tracking area update reject") != std::string::npos) {
+        if (matches.found(TRACKING_AREA_UPDATE_REJECT)) {
             tracking_area_update_reject = true;
             break;
         }
@@ -36,13 +56,12 @@ void extract_nas_emm_ota_incoming_packet(pt::ptree &&tree, Job &&job) {
     // If tracking area update request is neither accecpted or rejected,
     // we have nothing to print. Simply do nothing.
     if (!tracking_area_update_accept && !tracking_area_update_reject) {
-        insert_ordered_task(
-            job.job_num, [] {}
-        );
+        insert_ordered_task(job.job_num);
         return;
     }
 
-    std::string message;
+    auto task = acquire_ordered_task();
+    auto &message = task->output;
     message += timestamp + " $ LTE_NAS_EMM_OTA_Incoming_Packet $ "
                + "Tracking area update accept: ";
     if (tracking_area_update_accept) {
@@ -57,12 +76,9 @@ void extract_nas_emm_ota_incoming_packet(pt::ptree &&tree, Job &&job) {
         message += "0";
     }
 
-    insert_ordered_task(
-        job.job_num,
-        [message = std::move(message)] {
-            (*g_output) << message << std::endl;
-        }
-    );
+    message += '\n';
+
+    insert_ordered_task(job.job_num, task);
 }
 
 /// This function extracts and prints tracking area update request
@@ -77,16 +93,24 @@ void extract_nas_emm_ota_incoming_packet(pt::ptree &&tree, Job &&job) {
 /// </dm_log_packet>
 void extract_nas_emm_ota_outgoing_packet(
     pt::ptree &&tree, Job &&job) {
+    // If the string does not occur anywhere in the raw packet, there is no
+    // need to walk the tree.
+    if (!is_pattern_present(job, TRACKING_AREA_UPDATE_REQUEST)) {
+        insert_ordered_task(job.job_num);
+        return;
+    }
+
     std::string timestamp = get_packet_time_stamp(tree);
 
     bool tracking_area_update_request = false;
     auto &&nas_msg_emm_type_fields = locate_subtree_with_attribute(
         tree, "name", "nas_eps.nas_msg_emm_type"
     );
+    static thread_local PatternMatches matches;
     for (auto ptr : nas_msg_emm_type_fields) {
         auto &&showname = ptr->get("<xmlattr>.showname", std::string());
-        if (showname.find("Tracking area update request")
-            != std::string::npos) {
+        shared_pattern_scanner().scan(showname, matches);
+        if (matches.found(TRACKING_AREA_UPDATE_REQUEST)) {
             tracking_area_update_request = true;
             break;
         }
@@ -95,13 +119,12 @@ void extract_nas_emm_ota_outgoing_packet(
     // If the packet does not contain tracking area update request,
     // we have nothing to print. Simply do nothing.
     if (!tracking_area_update_request) {
-        insert_ordered_task(
-            job.job_num, [] {}
-        );
+        insert_ordered_task(job.job_num);
         return;
     }
 
-    std::string message;
+    auto task = acquire_ordered_task();
+    auto &message = task->output;
     message += timestamp + " $ LTE_NAS_EMM_OTA_Outgoing_Packet $ "
                + "Tracking area update request: ";
     if (tracking_area_update_request) {
@@ -110,10 +133,7 @@ void extract_nas_emm_ota_outgoing_packet(
         message += "0";
     }
 
-    insert_ordered_task(
-        job.job_num,
-        [message = std::move(message)] {
-            (*g_output) << message << std::endl;
-        }
-    );
+    message += '\n';
+
+    insert_ordered_task(job.job_num, task);
 }
@@ -16,12 +16,10 @@ void extract_packet_type(pt::ptree &&tree, Job &&job) {
         }
     }
 
-    insert_ordered_task(
-        job.job_num,
-        [timestamp = std::move(timestamp),
-         packet_type = std::move(packet_type)] {
-            (*g_output) << timestamp << " $ "
-                        << packet_type << std::endl;
-        }
-    );
+    auto task = acquire_ordered_task();
+    task->output += timestamp;
+    task->output += " $ ";
+    task->output += packet_type;
+    task->output += '\n';
+    insert_ordered_task(job.job_num, task);
 }
@@ -69,29 +69,24 @@ void extract_pdcp_cipher_data_pdu_packet(pt::ptree &&tree, Job &&job) {
     std::vector<std::string> dl_pdu_sizes, dl_bearer_id;
     extract_size_and_bearer_id("PDCPDL CIPH DATA", dl_pdu_sizes, dl_bearer_id);
 
-    insert_ordered_task(
-        job.job_num,
-        [timestamp = std::move(timestamp),
-         err_msg = std::move(err_msg),
-         ul_pdu_sizes = std::move(ul_pdu_sizes),
-         ul_bearer_id = std::move(ul_bearer_id),
-         dl_pdu_sizes = std::move(dl_pdu_sizes),
-         dl_bearer_id = std::move(dl_bearer_id)] {
-             std::cerr << err_msg;
-             for (auto i = 0; i < ul_pdu_sizes.size(); ++i) {
-                 (*g_output) << timestamp
-                             << " $ LTE_PDCP_UL_Cipher_Data_PDU $ "
-                             << "PDU Size: " << ul_pdu_sizes[i]
-                             << ", Bearer ID: " << ul_bearer_id[i]
-                             << std::endl;
-             }
-             for (auto i = 0; i < dl_pdu_sizes.size(); ++i) {
-                 (*g_output) << timestamp
-                             << " $ LTE_PDCP_DL_Cipher_Data_PDU $ "
-                             << "PDU Size: " << dl_pdu_sizes[i]
-                             << ", Bearer ID: " << dl_bearer_id[i]
-                             << std::endl;
-             }
-        }
-    );
+    auto task = acquire_ordered_task();
+    task->error.swap(err_msg);
+    auto &result = task->output;
+    for (auto i = 0; i < ul_pdu_sizes.size(); ++i) {
+        result += timestamp;
+        result += " $ LTE_PDCP_UL_Cipher_Data_PDU $ PDU Size: ";
+        result += ul_pdu_sizes[i];
+        result += ", Bearer ID: ";
+        result += ul_bearer_id[i];
+        result += '\n';
+    }
+    for (auto i = 0; i < dl_pdu_sizes.size(); ++i) {
+        result += timestamp;
+        result += " $ LTE_PDCP_DL_Cipher_Data_PDU $ PDU Size: ";
+        result += dl_pdu_sizes[i];
+        result += ", Bearer ID: ";
+        result += dl_bearer_id[i];
+        result += '\n';
+    }
+    insert_ordered_task(job.job_num, task);
 }
@@ -17,7 +17,11 @@ void extract_phy_pdsch_packet(pt::ptree &&tree, Job &&job) {
         "MCS 1"
     };
 
-    std::string result;
+    auto task = acquire_ordered_task();
+    auto &result = task->output;
+    result += timestamp;
+    result += " $ LTE_PHY_PDSCH_Packet $ ";
+    bool first = true;
     for (const auto &pair : tree.get_child("dm_log_packet")) {
         char const *match_key = nullptr;
         for (auto key : target_keys) {
@@ -27,21 +31,15 @@ void extract_phy_pdsch_packet(pt::ptree &&tree, Job &&job) {
             }
         }
         if (match_key == nullptr) continue;
-        if (!result.empty()) {
+        if (!first) {
             result += ", ";
         }
+        first = false;
         result += match_key;
         result += ": ",
         result += pair.second.get_value<std::string>();
     }
 
-    insert_ordered_task(
-        job.job_num,
-        [timestamp = std::move(timestamp),
-         result = std::move(result)] {
-            (*g_output) << timestamp
-                        << " $ LTE_PHY_PDSCH_Packet $ "
-                        << result << std::endl;
-        }
-    );
+    result += '\n';
+    insert_ordered_task(job.job_num, task);
 }
@@ -26,7 +26,8 @@ void extract_phy_pdsch_stat_packet(pt::ptree &&tree, Job &&job) {
         return trans_block_info_lst;
     };
 
-    std::string final_result;
+    auto task = acquire_ordered_task();
+    auto &final_result = task->output;
     auto &&record_lists = locate_disjoint_subtree_with_attribute(
         tree, "key", "Records"
     );
@@ -59,10 +60,5 @@ void extract_phy_pdsch_stat_packet(pt::ptree &&tree, Job &&job) {
         }
     }
 
-    insert_ordered_task(
-        job.job_num,
-        [final_result = std::move(final_result)] {
-            (*g_output) << final_result;
-        }
-    );
+    insert_ordered_task(job.job_num, task);
 }
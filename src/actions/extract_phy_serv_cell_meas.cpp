@@ -6,7 +6,8 @@
 void extract_phy_serv_cell_measurement(pt::ptree &&tree, Job &&job) {
     auto &&timestamp = get_packet_time_stamp(tree);
 
-    std::string result;
+    auto task = acquire_ordered_task();
+    auto &result = task->output;
     auto &&subpacket_lists = locate_subtree_with_attribute(
         tree, "key", "Subpackets"
     );
@@ -40,10 +41,5 @@ void extract_phy_serv_cell_measurement(pt::ptree &&tree, Job &&job) {
         }
     }
 
-    insert_ordered_task(
-        job.job_num,
-        [result = std::move(result)] {
-            (*g_output) << result;
-        }
-    );
+    insert_ordered_task(job.job_num, task);
 }
@@ -18,7 +18,8 @@ static void extract_rlc_am_all_pdu(pt::ptree &&tree, Job &&job, bool uplink) {
         result_tag = " $ LTE_RLC_DL_AM_All_PDU $ ";
     }
 
-    std::string result;
+    auto task = acquire_ordered_task();
+    auto &result = task->output;
     auto &&rlcdl_pdu_lists = locate_disjoint_subtree_with_attribute(
         tree, "key", rlc_lists_tag
     );
@@ -64,12 +65,7 @@ static void extract_rlc_am_all_pdu(pt::ptree &&tree, Job &&job, bool uplink) {
         }
     }
 
-    insert_ordered_task(
-        job.job_num,
-        [result = std::move(result)] {
-            (*g_output) << result;
-        }
-    );
+    insert_ordered_task(job.job_num, task);
 }
 
 void extract_rlc_dl_am_all_pdu(pt::ptree &&tree, Job &&job) {
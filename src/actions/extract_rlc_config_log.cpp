@@ -11,7 +11,8 @@
 static void extract_rlc_config_log_packet(
     pt::ptree &&tree, Job &&job, const char *pkt_name) {
     auto &&timestamp = get_packet_time_stamp(tree);
-    std::string result;
+    auto task = acquire_ordered_task();
+    auto &result = task->output;
 
     auto &&config_reasons = locate_disjoint_subtree_with_attribute(
         tree, "key", "Reason"
@@ -56,12 +57,7 @@ static void extract_rlc_config_log_packet(
     collect_rb_config_result("Released RBs");
     collect_rb_config_result("Active RBs");
 
-    insert_ordered_task(
-        job.job_num,
-        [result = std::move(result)] {
-            (*g_output) << result;
-        }
-    );
+    insert_ordered_task(job.job_num, task);
 }
 
 void extract_rlc_dl_config_log_packet(pt::ptree &&tree, Job &&job) {
@@ -3,6 +3,23 @@
 #include "actions.hpp"
 #include "global_states.hpp"
 #include "in_order_executor.hpp"
+#include <array>
+#include <cstdint>
+
+/// Print the timestamp and the direction of the last PDCP data packet.
+/// It must be called by the in-order executor.
+static void print_last_data_pdcp_packet_timestamp() {
+    (*g_output) << "LastPDCPPacketTimestamp: "
+                << g_last_pdcp_packet_timestamp
+                << ", Direction: ";
+    if (g_last_pdcp_packet_direction == PDCPDirection::Downlink) {
+        (*g_output) << "downlink";
+    } else if (g_last_pdcp_packet_direction == PDCPDirection::Uplink) {
+        (*g_output) << "uplink";
+    } else {
+        (*g_output) << "unknown";
+    }
+}
 
 /// This function extracts several kinds of information from RRC_OTA
 /// packets. Currently 14 kinds of information are extracted.
@@ -335,148 +352,162 @@ void extract_rrc_ota_packet(pt::ptree &&tree, Job &&job) {
             tree, "showname", "rrcConnectionReject"
     );
 
-    // Send the closure to ordered task executor to print extracted
-    // information out.
-    insert_ordered_task(
-        job.job_num,
-        [timestamp = std::move(timestamp),
-         added_config_ids = std::move(added_config_ids),
-         added_event_types = std::move(added_event_types),
-         removed_config_ids = std::move(removed_config_ids),
-         added_measure_ids = std::move(added_measure_ids),
-         report_to_measure_ids = std::move(report_to_measure_ids),
-         removed_measure_ids = std::move(removed_measure_ids),
-         measurement_reports = std::move(measurement_reports),
-         warning_message = std::move(warning_message),
-         rrc_connection_reestablishment_request_present,
-         rrc_connection_reestablishment_complete_present,
-         rrc_connection_reestablishment_reject_present,
-         rrc_connection_reconfiguration_present,
-         mobility_control_info_present,
-         target_cells = std::move(target_cells),
-         connection_reestablishment_cause
-            = std::move(connection_reestablishment_cause),
-         rrc_connection_reconfiguration_complete_present,
-         rrc_connection_release_present,
-         rrc_connection_request_present,
-         rrc_connection_setup_present,
-         rrc_connection_reject_present] {
-            auto print_last_data_pdcp_packet_timestamp = [] {
-            (*g_output) << "LastPDCPPacketTimestamp: "
-                        << g_last_pdcp_packet_timestamp
-                        << ", Direction: ";
-                if (g_last_pdcp_packet_direction == PDCPDirection::Downlink) {
-                    (*g_output) << "downlink";
-                } else if (g_last_pdcp_packet_direction
-                            == PDCPDirection::Uplink) {
-                    (*g_output) << "uplink";
-                } else {
-                    (*g_output) << "unknown";
-                }
-            };
+    // Lines that do not depend on the state of preceding packets are
+    // formatted here, in the extractor thread.
+    auto task = acquire_ordered_task();
+    task->error.swap(warning_message);
+    auto &result = task->output;
+    for (auto &i : removed_config_ids) {
+        result += timestamp;
+        result += " $ reportConfigToRemoveList $ ";
+        result += i;
+        result += '\n';
+    }
+    for (auto &i : removed_measure_ids) {
+        result += timestamp;
+        result += " $ measIdToRemoveList $ ";
+        result += i;
+        result += '\n';
+    }
+    for (auto i = 0; i < added_config_ids.size(); ++i) {
+        result += timestamp;
+        result += " $ ReportConfigToAddMod $ ";
+        result += added_config_ids[i];
+        result += ", ";
+        result += added_event_types[i];
+        result += '\n';
+    }
+    for (auto i = 0; i < added_measure_ids.size(); ++i) {
+        result += timestamp;
+        result += " $ MeasIdToAddMod $ ";
+        result += added_measure_ids[i];
+        result += ", ";
+        result += report_to_measure_ids[i];
+        result += '\n';
+    }
+    for (auto &i : measurement_reports) {
+        result += timestamp;
+        result += " $ measResults $ ";
+        result += i;
+        result += '\n';
+    }
 
-            auto set_connection_disruption =
-                [] (DisruptionEventEnum event_type) {
-                g_distuption_events.is_being_disrupted = true;
-                g_distuption_events.disruptions[
-                    static_cast<int>(event_type)
-                ] = true;
-            };
+    // The remaining lines are formatted here as well, but some of them
+    // contain the last PDCP packet, which is only known to the in-order
+    // executor. They are appended to the payload, leaving holes that the
+    // executor fills in when splicing the payload to the output.
+    auto &tail = task->payload;
+    std::array<std::uint32_t, 3> holes;
+    int hole_num = 0;
+    auto add_hole = [&tail, &holes, &hole_num] {
+        holes[hole_num++] = static_cast<std::uint32_t>(tail.size());
+    };
+    // The bitmask of the disruption events started by this packet.
+    unsigned disruptions = 0;
+    auto set_connection_disruption =
+        [&disruptions] (DisruptionEventEnum event_type) {
+        disruptions |= 1u << static_cast<int>(event_type);
+    };
 
-            std::cerr << warning_message;
-            for (auto &i : removed_config_ids) {
-                (*g_output) << timestamp << " $ reportConfigToRemoveList $ "
-                            << i << std::endl;
-            }
-            for (auto &i : removed_measure_ids) {
-                (*g_output) << timestamp << " $ measIdToRemoveList $ "
-                            << i << std::endl;
-            }
-            for (auto i = 0; i < added_config_ids.size(); ++i) {
-                (*g_output) << timestamp << " $ ReportConfigToAddMod $ "
-                            << added_config_ids[i]
-                            << ", " << added_event_types[i] << std::endl;
-            }
-            for (auto i = 0; i < added_measure_ids.size(); ++i) {
-                (*g_output) << timestamp << " $ MeasIdToAddMod $ "
-                            << added_measure_ids[i] << ", "
-                            << report_to_measure_ids[i] << std::endl;
-            }
-            for (auto &i : measurement_reports) {
-                (*g_output) << timestamp << " $ measResults $ "
-                            << i << std::endl;
-            }
-            if (rrc_connection_reestablishment_request_present) {
-                (*g_output) << timestamp
-                            << " $ rrcConnectionReestablishmentRequest $ ";
-                print_last_data_pdcp_packet_timestamp();
-                set_connection_disruption(
-                    DisruptionEventEnum::RRCConnectionReestablishmentRequest
-                );;
-                if (!connection_reestablishment_cause.empty()) {
-                    (*g_output) << ", " << connection_reestablishment_cause;
-                }
-                (*g_output) << std::endl;
-            }
-            if (rrc_connection_reestablishment_complete_present) {
-                (*g_output) << timestamp
-                            << " $ rrcConnectionReestablishmentComplete $"
-                            << std::endl;
-                set_connection_disruption(
-                    DisruptionEventEnum::RRCConnectionReestablishmentComplete
-                );
-            }
-            if (rrc_connection_reestablishment_reject_present) {
-                (*g_output) << timestamp
-                            << " $ rrcConnectionReestablishmentReject $"
-                            << std::endl;
-            }
-            if (rrc_connection_reconfiguration_present) {
-                (*g_output) << timestamp << " $ rrcConnectionReconfiguration $"
-                            << " mobilityControlInfo: ";
-                if (mobility_control_info_present) {
-                    (*g_output) << "1, "
-                                << target_cells;
-                } else {
-                    (*g_output) << '0';
+    if (rrc_connection_reestablishment_request_present) {
+        tail += timestamp;
+        tail += " $ rrcConnectionReestablishmentRequest $ ";
+        add_hole();
+        set_connection_disruption(
+            DisruptionEventEnum::RRCConnectionReestablishmentRequest
+        );
+        if (!connection_reestablishment_cause.empty()) {
+            tail += ", ";
+            tail += connection_reestablishment_cause;
+        }
+        tail += '\n';
+    }
+    if (rrc_connection_reestablishment_complete_present) {
+        tail += timestamp;
+        tail += " $ rrcConnectionReestablishmentComplete $\n";
+        set_connection_disruption(
+            DisruptionEventEnum::RRCConnectionReestablishmentComplete
+        );
+    }
+    if (rrc_connection_reestablishment_reject_present) {
+        tail += timestamp;
+        tail += " $ rrcConnectionReestablishmentReject $\n";
+    }
+    if (rrc_connection_reconfiguration_present) {
+        tail += timestamp;
+        tail += " $ rrcConnectionReconfiguration $ mobilityControlInfo: ";
+        if (mobility_control_info_present) {
+            tail += "1, ";
+            tail += target_cells;
+        } else {
+            tail += '0';
+        }
+        tail += ", ";
+        add_hole();
+        set_connection_disruption(
+            DisruptionEventEnum::RRCConnectionReconfiguration
+        );
+        tail += '\n';
+    }
+    if (rrc_connection_reconfiguration_complete_present) {
+        tail += timestamp;
+        tail += " $ rrcConnectionReconfigurationComplete $\n";
+        set_connection_disruption(
+            DisruptionEventEnum::RRCConnectionReconfigurationComplete
+        );
+    }
+    if (rrc_connection_release_present) {
+        tail += timestamp;
+        tail += " $ rrcConnectionRelease $\n";
+    }
+    if (rrc_connection_request_present) {
+        tail += timestamp;
+        tail += " $ rrcConnectionRequest $ ";
+        add_hole();
+        set_connection_disruption(
+            DisruptionEventEnum::RRCConnectionRequest
+        );
+        tail += '\n';
+    }
+    if (rrc_connection_setup_present) {
+        tail += timestamp;
+        tail += " $ rrcConnectionSetup $\n";
+        set_connection_disruption(
+            DisruptionEventEnum::RRCConnectionSetup
+        );
+    }
+    if (rrc_connection_reject_present) {
+        tail += timestamp;
+        tail += " $ rrcConnectionReject $\n";
+    }
+
+    // Nothing depends on the states shared across packets.
+    if (hole_num == 0 && disruptions == 0) {
+        task->output += tail;
+        insert_ordered_task(job.job_num, task);
+        return;
+    }
+
+    task->update.emplace([holes, hole_num, disruptions](OrderedTask &task) {
+        const auto &tail = task.payload;
+        std::size_t start = 0;
+        for (int i = 0; i < hole_num; ++i) {
+            g_output->write(tail.data() + start, holes[i] - start);
+            print_last_data_pdcp_packet_timestamp();
+            start = holes[i];
+        }
+        g_output->write(tail.data() + start, tail.size() - start);
+
+        if (disruptions != 0) {
+            g_distuption_events.is_being_disrupted = true;
+            for (int i = 0;
+                i < static_cast<int>(DisruptionEventEnum::NumberOfDisruptions);
+                ++i) {
+                if (disruptions & (1u << i)) {
+                    g_distuption_events.disruptions[i] = true;
                 }
-                (*g_output) << ", ";
-                print_last_data_pdcp_packet_timestamp();
-                set_connection_disruption(
-                    DisruptionEventEnum::RRCConnectionReconfiguration
-                );
-                (*g_output) << std::endl;
-            }
-            if (rrc_connection_reconfiguration_complete_present) {
-                (*g_output) << timestamp
-                            << " $ rrcConnectionReconfigurationComplete $"
-                            << std::endl;
-                set_connection_disruption(
-                    DisruptionEventEnum::RRCConnectionReconfigurationComplete
-                );
-            }
-            if (rrc_connection_release_present) {
-                (*g_output) << timestamp << " $ rrcConnectionRelease $"
-                            << std::endl;
-            }
-            if (rrc_connection_request_present) {
-                (*g_output) << timestamp << " $ rrcConnectionRequest $ ";
-                print_last_data_pdcp_packet_timestamp();
-                set_connection_disruption(
-                    DisruptionEventEnum::RRCConnectionRequest
-                );
-                (*g_output) << std::endl;
-            }
-            if (rrc_connection_setup_present) {
-                (*g_output) << timestamp << " $ rrcConnectionSetup $"
-                            << std::endl;
-                set_connection_disruption(
-                    DisruptionEventEnum::RRCConnectionSetup
-                );
-            }
-            if (rrc_connection_reject_present) {
-                (*g_output) << timestamp << " $ rrcConnectionReject $"
-                            << std::endl;
             }
+        }
     });
+    insert_ordered_task(job.job_num, task);
 }
@@ -52,7 +52,8 @@ void extract_rrc_serv_cell_info_packet(
         }
     }
 
-    std::string err_msg;
+    auto task = acquire_ordered_task();
+    auto &err_msg = task->error;
     if_unlikely (timestamp.empty() || cell_id.empty() || dl_freq.empty()
                  || ul_freq.empty() || dl_bandwidth.empty()
                  || ul_bandwidth.empty() || cell_identity.empty()
@@ -90,24 +91,22 @@ void extract_rrc_serv_cell_info_packet(
                    + std::to_string(job.end_line_number) + "\n";
     }
 
-    insert_ordered_task(
-        job.job_num,
-        [timestamp = std::move(timestamp), cell_id = std::move(cell_id),
-         dl_freq = std::move(dl_freq), ul_freq = std::move(ul_freq),
-         dl_bandwidth = std::move(dl_bandwidth),
-         ul_bandwidth = std::move(ul_bandwidth),
-         cell_identity = std::move(cell_identity),
-         tracking_area_code = std::move(tracking_area_code),
-         err_msg = std::move(err_msg)] {
-             std::cerr << err_msg;
-             (*g_output) << timestamp << " $ LTE_RRC_Serv_Cell_Info $ "
-                         << "Cell ID: " << cell_id << ", "
-                         << "Downlink frequency: " << dl_freq << ", "
-                         << "Uplink frequency: " << ul_freq << ", "
-                         << "Downlink bandwidth: " << dl_bandwidth << ", "
-                         << "Uplink bandwidth: " << ul_bandwidth << ", "
-                         << "Cell Identity: " << cell_identity << ", "
-                         << "TAC: " << tracking_area_code << std::endl;
-        }
-    );
+    auto &result = task->output;
+    result += timestamp;
+    result += " $ LTE_RRC_Serv_Cell_Info $ Cell ID: ";
+    result += cell_id;
+    result += ", Downlink frequency: ";
+    result += dl_freq;
+    result += ", Uplink frequency: ";
+    result += ul_freq;
+    result += ", Downlink bandwidth: ";
+    result += dl_bandwidth;
+    result += ", Uplink bandwidth: ";
+    result += ul_bandwidth;
+    result += ", Cell Identity: ";
+    result += cell_identity;
+    result += ", TAC: ";
+    result += tracking_area_code;
+    result += '\n';
+    insert_ordered_task(job.job_num, task);
 }
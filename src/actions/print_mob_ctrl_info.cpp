@@ -18,18 +18,29 @@ bool recursive_find_mobility_control_info(const pt::ptree &tree) {
     return false;
 }
 
+/// The id of "mobilityControlInfo is present" in the shared scanner.
+static const int MOBILITY_CONTROL_INFO =
+    register_scan_pattern("mobilityControlInfo is present");
+
+// Yield true if the raw XML text contains "mobilityControlInfo is present"
+// as a substring. Unlike the recursive version, it does not walk the tree.
+bool is_mobility_control_info_present(const Job &job) {
+    return is_pattern_present(job, MOBILITY_CONTROL_INFO);
+}
+
 void print_time_of_mobility_control_info(pt::ptree &&tree, Job &&job) {
     for (const auto &i : tree.get_child("dm_log_packet")) {
         if (i.first == "pair") {
             if (i.second.get<std::string>("<xmlattr>.key") == "timestamp") {
-                auto timestamp = i.second.data();
-                insert_ordered_task(job.job_num, [timestamp] {
-                    (*g_output) << "[" << timestamp
-                                << "] [mobilityControlInfo] $ "
-                                << "LastPDCPPacketTimestamp: "
-                                << g_last_pdcp_packet_timestamp
-                                << std::endl;
+                auto task = acquire_ordered_task();
+                task->output += "[";
+                task->output += i.second.data();
+                task->output += "] [mobilityControlInfo] $ "
+                                "LastPDCPPacketTimestamp: ";
+                task->update.emplace([](OrderedTask &task) {
+                    (*g_output) << g_last_pdcp_packet_timestamp << '\n';
                 });
+                insert_ordered_task(job.job_num, task);
                 break;
             }
         }
@@ -10,10 +10,10 @@ void print_timestamp(pt::ptree &&tree, long seq_num) {
     for (const auto &i : tree.get_child("dm_log_packet")) {
         if (i.first == "pair") {
             if (i.second.get<std::string>("<xmlattr>.key") == "timestamp") {
-                auto timestamp = i.second.data();
-                insert_ordered_task(seq_num, [timestamp] {
-                    (*g_output) << timestamp << std::endl;
-                });
+                auto task = acquire_ordered_task();
+                task->output += i.second.data();
+                task->output += '\n';
+                insert_ordered_task(seq_num, task);
                 break;
             }
         }
@@ -0,0 +1,18 @@
+/* Copyright [2020] Zhiyao Ma */
+#include "actions.hpp"
+#include "global_states.hpp"
+#include "in_order_executor.hpp"
+
+/// Count the packet in the disorder profile. The timestamp is found in the
+/// raw text, and the XML tree is not built for this action.
+void profile_packet_disorder(pt::ptree &&tree, Job &&job) {
+    auto rawtime = scan_packet_timestamp(job.xml_string);
+
+    // The inversion distance depends on the packets before, so the profile
+    // is updated by the in-order executor.
+    auto task = acquire_ordered_task();
+    task->update.emplace([rawtime](OrderedTask &task) {
+        g_disorder_profile->add(rawtime);
+    });
+    insert_ordered_task(job.job_num, task);
+}
@@ -3,6 +3,7 @@
 #include "exceptions.hpp"
 #include "global_states.hpp"
 #include "in_order_executor.hpp"
+#include <cstdint>
 
 /// This function extracts and update the global string containing the
 /// timestamp of the last LTE_PDCP_UL_Cipher_Data_PDU or
@@ -31,35 +32,43 @@ void update_pdcp_cipher_data_pdu_packet_timestamp(
         }
     }
 
-    auto print_timestamp_of_first_pdcp_packet_after_disruption =
-        [timestamp, direction] {
+    // The line reporting a disruption ended by this packet is formatted
+    // here, leaving a hole for the type of the disruption. The payload
+    // holds the text before and after the hole, and the timestamp is its
+    // prefix.
+    static constexpr char disruption_tag[] =
+        " $ FirstPDCPPacketAfterDisruption $ Disruption Type: ";
+    auto format_payload = [&timestamp, direction](std::string &payload) {
+        payload += timestamp;
+        payload += disruption_tag;
+        payload += direction == PDCPDirection::Uplink
+                   ? ", Direction: uplink\n"
+                   : ", Direction: downlink\n";
+    };
+    std::uint32_t timestamp_size = timestamp.size();
+    std::uint32_t hole = timestamp_size + sizeof(disruption_tag) - 1;
+
+    // Runs in the in-order executor: reports the disruptions ended by
+    // this packet and records it as the latest PDCP data packet.
+    auto update_last_pdcp_packet =
+        [direction, timestamp_size, hole](OrderedTask &task) {
+        const auto &payload = task.payload;
         if (g_distuption_events.is_being_disrupted) {
             for (int i = 0;
                 i < static_cast<int>(DisruptionEventEnum::NumberOfDisruptions);
                 ++i) {
                 if (g_distuption_events.disruptions[i]) {
-                    (*g_output) << timestamp
-                                << " $ FirstPDCPPacketAfterDisruption $ "
-                                << "Disruption Type: "
-                                << DisruptionEventNames[i]
-                                << ", Direction: ";
-                    switch (direction) {
-                    case PDCPDirection::Unknown:
-                        (*g_output) << "unknown";
-                        break;
-                    case PDCPDirection::Uplink:
-                        (*g_output) << "uplink";
-                        break;
-                    case PDCPDirection::Downlink:
-                        (*g_output) << "downlink";
-                        break;
-                    }
-                    (*g_output) << std::endl;
+                    g_output->write(payload.data(), hole);
+                    (*g_output) << DisruptionEventNames[i];
+                    g_output->write(payload.data() + hole,
+                                    payload.size() - hole);
                     g_distuption_events.disruptions[i] = false;
                 }
             }
             g_distuption_events.is_being_disrupted = false;
         }
+        g_last_pdcp_packet_timestamp.assign(payload.data(), timestamp_size);
+        g_last_pdcp_packet_direction = direction;
     };
 
     switch (direction) {
@@ -97,15 +106,10 @@ void update_pdcp_cipher_data_pdu_packet_timestamp(
                 }
             }
             if (uplink_pdcp_data_packet_present) {
-                insert_ordered_task(
-                    job.job_num,
-                    [timestamp = std::move(timestamp),
-                     print_timestamp_of_first_pdcp_packet_after_disruption] {
-                        print_timestamp_of_first_pdcp_packet_after_disruption();
-                        g_last_pdcp_packet_timestamp = std::move(timestamp);
-                        g_last_pdcp_packet_direction = PDCPDirection::Uplink;
-                    }
-                );
+                auto task = acquire_ordered_task();
+                format_payload(task->payload);
+                task->update.emplace(update_last_pdcp_packet);
+                insert_ordered_task(job.job_num, task);
                 return;
             }
         }
@@ -137,15 +141,10 @@ void update_pdcp_cipher_data_pdu_packet_timestamp(
                 }
             }
             if (downlink_pdcp_data_packet_present) {
-                insert_ordered_task(
-                    job.job_num,
-                    [timestamp = std::move(timestamp),
-                     print_timestamp_of_first_pdcp_packet_after_disruption] {
-                        print_timestamp_of_first_pdcp_packet_after_disruption();
-                        g_last_pdcp_packet_timestamp = std::move(timestamp);
-                        g_last_pdcp_packet_direction = PDCPDirection::Downlink;
-                    }
-                );
+                auto task = acquire_ordered_task();
+                format_payload(task->payload);
+                task->update.emplace(update_last_pdcp_packet);
+                insert_ordered_task(job.job_num, task);
                 return;
             }
         }
@@ -157,8 +156,5 @@ void update_pdcp_cipher_data_pdu_packet_timestamp(
         );
     }
 
-    insert_ordered_task(
-        job.job_num,
-        [] {}
-    );
+    insert_ordered_task(job.job_num);
 }
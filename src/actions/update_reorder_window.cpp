@@ -3,33 +3,101 @@
 #include "actions.hpp"
 #include "global_states.hpp"
 #include "in_order_executor.hpp"
+#include "lz4_block.hpp"
+#include "xxh64.hpp"
+
+/// Check the packet against the duplicate filter, if it is set, before it
+/// enters the window. The timestamp text at the end of `record` is only
+/// kept for the message about a duplicate, and is taken off otherwise.
+/// Return false if the packet is a duplicate and dropped.
+static bool admit_packet(time_t rawtime, std::uint64_t hash,
+                         std::string &record, std::size_t &ts_size) {
+    if (g_duplicate_filter == nullptr) {
+        return true;
+    }
+    auto ts_offset = record.size() - ts_size;
+    if (!g_duplicate_filter->insert(rawtime, hash)) {
+        (*g_error_output) << "Dropping duplicate packet: ";
+        g_error_output->write(record.data() + ts_offset, ts_size);
+        (*g_error_output) << '\n';
+        return false;
+    }
+    record.resize(ts_offset);
+    ts_size = 0;
+    return true;
+}
 
 void update_reorder_window(pt::ptree &&tree, Job &&job) {
     auto &&timestamp = get_packet_time_stamp(tree);
 
     auto rawtime = timestamp_str2long_microsec_hack(timestamp);
     if_unlikely (rawtime == static_cast<time_t>(-1)) {
-        insert_ordered_task(
-            job.job_num,
-            [timestamp = std::move(timestamp)] {
-                std::cerr << "Warning (packet timestamp = "
-                          + timestamp + "): \n"
-                          << "Timestamp does not match the pattern "
-                          << "\"%d-%d-%d %d:%d:%d.%d\" "
-                          << "or \"%d-%d-%d %d:%d:%d\". "
-                          << "Dropped." << std::endl;
+        drop_packet_with_invalid_timestamp(job.job_num, timestamp);
+        return;
+    }
+
+    // The deduplication needs the timestamp text for its messages, which is
+    // kept after the rest of the record of the packet. The text is hashed
+    // here for the duplicate filter, so that the executor only looks it up.
+    auto task = acquire_ordered_task();
+    std::size_t ts_size = 0;
+    std::uint64_t hash = 0;
+    if (g_reorder_window->is_deduplicating()
+        || g_duplicate_filter != nullptr) {
+        ts_size = timestamp.size();
+    }
+    if (g_duplicate_filter != nullptr) {
+        hash = hash_xxh64(job.xml_string.data(), job.xml_string.size());
+    }
+
+    // Leave the text in the input file if the window can read it again.
+    if (g_reorder_window->is_referencing_inputs()) {
+        auto file_idx = job.file_idx;
+        auto file_offset = job.file_offset;
+        auto size = job.xml_string.size();
+        task->payload.assign(timestamp, 0, ts_size);
+        task->update.emplace(
+            [rawtime, hash, file_idx, file_offset, size](OrderedTask &task) {
+                auto ts_size = task.payload.size();
+                if (admit_packet(rawtime, hash, task.payload, ts_size)) {
+                    g_reorder_window->update(rawtime, file_idx, file_offset,
+                                             size, std::move(task.payload));
+                }
             }
         );
+        insert_ordered_task(job.job_num, task);
         return;
     }
-
-    auto &&content = job.xml_string;
-    insert_ordered_task(
-        job.job_num,
-        [content, rawtime]() mutable {
-            g_reorder_window->update(
-                rawtime, std::move(content)
+    // Compress the text here, so that the executor only copies it.
+    if (g_reorder_window->is_compressing()) {
+        compress_lz4_block(job.xml_string.data(), job.xml_string.size(),
+                           task->payload);
+        if (task->payload.size() < job.xml_string.size()) {
+            auto size = job.xml_string.size();
+            task->payload.append(timestamp, 0, ts_size);
+            task->update.emplace(
+                [rawtime, hash, size, ts_size](OrderedTask &task) {
+                    auto record_ts_size = ts_size;
+                    if (admit_packet(rawtime, hash, task.payload,
+                                     record_ts_size)) {
+                        g_reorder_window->update(rawtime,
+                                                 std::move(task.payload),
+                                                 size, record_ts_size);
+                    }
+                }
             );
+            insert_ordered_task(job.job_num, task);
+            return;
+        }
+    }
+    task->payload.swap(job.xml_string);
+    task->payload.append(timestamp, 0, ts_size);
+    task->update.emplace([rawtime, hash, ts_size](OrderedTask &task) {
+        auto record_ts_size = ts_size;
+        if (admit_packet(rawtime, hash, task.payload, record_ts_size)) {
+            g_reorder_window->update(rawtime, std::move(task.payload),
+                                     record_ts_size);
         }
-    );
+    });
+    insert_ordered_task(job.job_num, task);
 }
@@ -1,6 +1,8 @@
 /* Copyright [2020] Zhiyao Ma */
 #include "actions.hpp"
 #include "exceptions.hpp"
+#include "global_states.hpp"
+#include "in_order_executor.hpp"
 
 /// Return the `type_id` field in the packet.
 std::string get_packet_type(const pt::ptree &tree) {
@@ -84,6 +86,58 @@ time_t timestamp_str2long_microsec_hack(const std::string &timestamp) {
     return ((mktime(&s) + 28800) * 1000000) + mircosec;
 }
 
+/// Find the timestamp text of the packet in its raw XML text, without
+/// parsing the text. Return "timestamp N/A" if there is none, as
+/// `get_packet_time_stamp` does.
+std::string scan_packet_timestamp_text(const std::string &xml) {
+    static const char key[] = "key=\"timestamp\">";
+    auto start = xml.find(key);
+    if (start == std::string::npos) {
+        return "timestamp N/A";
+    }
+    start += sizeof(key) - 1;
+    auto end = xml.find('<', start);
+    if (end == std::string::npos) {
+        return "timestamp N/A";
+    }
+    return xml.substr(start, end - start);
+}
+
+/// Find the timestamp of the packet in its raw XML text, without parsing
+/// the text. Return -1 if there is no valid timestamp.
+time_t scan_packet_timestamp(const std::string &xml) {
+    return timestamp_str2long_microsec_hack(scan_packet_timestamp_text(xml));
+}
+
+/// Drop the packet of the job because its timestamp is invalid, with a
+/// warning printed in order with the output.
+void drop_packet_with_invalid_timestamp(
+    long job_num, const std::string &timestamp) {
+    auto task = acquire_ordered_task();
+    task->error += "Warning (packet timestamp = ";
+    task->error += timestamp;
+    task->error += "): \nTimestamp does not match the pattern "
+                   "\"%d-%d-%d %d:%d:%d.%d\" "
+                   "or \"%d-%d-%d %d:%d:%d\". Dropped.\n";
+    insert_ordered_task(job_num, task);
+}
+
+/// Scan the raw XML text of the job for all registered patterns. The text
+/// is scanned only once per job, and the result is cached in the job, so
+/// that all predicate and action functions share a single pass.
+const PatternMatches &scan_packet_patterns(const Job &job) {
+    if (!job.pattern_matches.scanned) {
+        shared_pattern_scanner().scan(job.xml_string, job.pattern_matches);
+    }
+    return job.pattern_matches;
+}
+
+/// Return true if and only if the pattern, given by the id returned by
+/// `register_scan_pattern`, occurs in the raw XML text.
+bool is_pattern_present(const Job &job, int pattern_id) {
+    return scan_packet_patterns(job).found(pattern_id);
+}
+
 /// Check whether the tree has an attribute as its direct child.
 bool is_tree_having_attribute(
     const pt::ptree &tree, const std::string &key, const std::string &val) {
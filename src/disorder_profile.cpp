@@ -0,0 +1,95 @@
+/**
+ * Copyright [2020] Zhiyao Ma
+ *
+ * This module implements the disorder profile of the packet timestamps.
+ *
+ * The packets are fed in the order of the input. Each of them is compared
+ * with the newest timestamp seen before it, and if it is older, the
+ * difference is its inversion distance. A reorder window of that size is
+ * just enough to put the packet in place, so the largest distance is the
+ * smallest window that sorts the whole input.
+ *
+ * The distances are counted in a log-linear histogram. The buckets below
+ * `SUB_BUCKET_NUM` microseconds are one microsecond wide, and each power of
+ * 2 above is split into `SUB_BUCKET_NUM` buckets of equal width.
+ */
+#include "disorder_profile.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+DisorderProfile::DisorderProfile() : buckets(64 * SUB_BUCKET_NUM, 0) {}
+
+/// Return the bucket counting the positive distance.
+int DisorderProfile::bucket_index(time_t distance) {
+    if (distance < SUB_BUCKET_NUM) {
+        return static_cast<int>(distance);
+    }
+    int exponent = 63 - __builtin_clzll(static_cast<unsigned long long>(
+                                            distance));
+    int shift = exponent - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKET_NUM
+           + static_cast<int>((distance >> shift) & (SUB_BUCKET_NUM - 1));
+}
+
+/// Return the largest distance counted in the bucket.
+time_t DisorderProfile::bucket_upper_bound(int index) {
+    if (index < SUB_BUCKET_NUM) {
+        return index;
+    }
+    int shift = index / SUB_BUCKET_NUM - 1;
+    time_t lower = static_cast<time_t>(SUB_BUCKET_NUM
+                                       + index % SUB_BUCKET_NUM) << shift;
+    return lower + (static_cast<time_t>(1) << shift) - 1;
+}
+
+/// Count a packet in the order of the input.
+void DisorderProfile::add(time_t timestamp) {
+    if (timestamp == static_cast<time_t>(-1)) {
+        ++invalid_packet_num;
+        return;
+    }
+    if (packet_num++ == 0 || timestamp >= largest_time) {
+        largest_time = timestamp;
+        return;
+    }
+    auto distance = largest_time - timestamp;
+    ++buckets[bucket_index(distance)];
+    ++inverted_packet_num;
+    largest_inversion = std::max(largest_inversion, distance);
+}
+
+/// Return the distance which the given fraction of the inverted packets do
+/// not exceed, rounded up to the end of its bucket.
+time_t DisorderProfile::percentile(double fraction) const {
+    auto rank = static_cast<long>(std::ceil(fraction * inverted_packet_num));
+    long count = 0;
+    for (int i = 0; i < static_cast<int>(buckets.size()); ++i) {
+        count += buckets[i];
+        if (count >= rank && count > 0) {
+            return std::min(bucket_upper_bound(i), largest_inversion);
+        }
+    }
+    return largest_inversion;
+}
+
+/// Write the numbers of packets and the percentiles of the inversion
+/// distances, in microseconds.
+void DisorderProfile::report(std::ostream &out) const {
+    out << "Packets: " << packet_num << '\n'
+        << "Packets without a valid timestamp: " << invalid_packet_num << '\n'
+        << "Inverted packets: " << inverted_packet_num;
+    if (packet_num > 0) {
+        out << " (" << std::fixed << std::setprecision(3)
+            << 100.0 * inverted_packet_num / packet_num << "%)";
+    }
+    out << '\n'
+        << "Inversion distance of the inverted packets (microseconds):\n"
+        << "  p50: " << percentile(0.5) << '\n'
+        << "  p90: " << percentile(0.9) << '\n'
+        << "  p99: " << percentile(0.99) << '\n'
+        << "  p99.9: " << percentile(0.999) << '\n'
+        << "  max: " << largest_inversion << '\n'
+        << "Smallest reorder window sorting the input: "
+        << largest_inversion << '\n';
+}
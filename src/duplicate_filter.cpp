@@ -0,0 +1,124 @@
+/**
+ * Copyright [2020] Zhiyao Ma
+ *
+ * This module implements the duplicate filter of the content-based
+ * deduplication.
+ *
+ * The filter keeps the 64-bit hashes of the packet texts in an open
+ * addressing hash table with linear probing, so that a lookup is a few
+ * adjacent memory accesses. The hashes are also queued in the order they
+ * are added. Once the newest timestamp moves more than the horizon past
+ * the timestamp of the hash at the front of the queue, the hash is removed
+ * from the table, with the entries after it in the probe sequence shifted
+ * back instead of leaving tombstones. The memory thus only depends on the
+ * number of packets within the horizon, however long the input is.
+ *
+ * Two different texts are taken as the same packet only if their hashes
+ * collide, which takes about 4 billion packets within the horizon to
+ * happen once.
+ */
+#include "duplicate_filter.hpp"
+#include "memory_governor.hpp"
+#include "exceptions.hpp"
+#include "parameters.hpp"
+#include <algorithm>
+
+DuplicateFilter::DuplicateFilter(time_t horizon_)
+    : slots(DUPLICATE_FILTER_INITIAL_SIZE, Slot {0, 0}) {
+    if (static_cast<long>(horizon_) <= 0L) {
+        throw ArgumentError(
+            "Deduplicate horizon must be greater than 0, "
+            "given: " + std::to_string(horizon_)
+        );
+    }
+    horizon = horizon_;
+    charge_memory(MemoryUse::DuplicateFilter, slots.size() * sizeof(Slot));
+}
+
+DuplicateFilter::~DuplicateFilter() {
+    release_memory(MemoryUse::DuplicateFilter,
+                   (slots.size() + history.size()) * sizeof(Slot));
+}
+
+/// Return the index of the slot holding the hash, or of the empty slot
+/// ending its probe sequence.
+std::size_t DuplicateFilter::find(std::uint64_t hash) const {
+    auto mask = slots.size() - 1;
+    auto index = static_cast<std::size_t>(hash) & mask;
+    while (slots[index].hash != 0 && slots[index].hash != hash) {
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+/// Empty the slot, and move back the entries after it that would no longer
+/// be reachable from their home slots.
+void DuplicateFilter::erase(std::size_t index) {
+    auto mask = slots.size() - 1;
+    auto next = index;
+    while (true) {
+        next = (next + 1) & mask;
+        if (slots[next].hash == 0) {
+            break;
+        }
+        auto home = static_cast<std::size_t>(slots[next].hash) & mask;
+        // Move the entry if its home is not cyclically in (index, next].
+        if (((next - home) & mask) >= ((next - index) & mask)) {
+            slots[index] = slots[next];
+            index = next;
+        }
+    }
+    slots[index].hash = 0;
+    --slot_num_used;
+}
+
+/// Double the hash table.
+void DuplicateFilter::grow() {
+    std::vector<Slot> old_slots(slots.size() * 2, Slot {0, 0});
+    old_slots.swap(slots);
+    charge_memory(MemoryUse::DuplicateFilter, old_slots.size() * sizeof(Slot));
+    for (const auto &slot : old_slots) {
+        if (slot.hash != 0) {
+            slots[find(slot.hash)] = slot;
+        }
+    }
+}
+
+/// Remove the hashes older than the horizon from the newest timestamp.
+void DuplicateFilter::evict() {
+    while (!history.empty()
+           && largest_time - history.front().timestamp > horizon) {
+        const auto &oldest = history.front();
+        auto index = find(oldest.hash);
+        if (slots[index].hash != 0
+            && slots[index].timestamp == oldest.timestamp) {
+            erase(index);
+        }
+        history.pop_front();
+        release_memory(MemoryUse::DuplicateFilter, sizeof(Slot));
+    }
+}
+
+/// Add the hash of a packet text. Return false if it is a duplicate.
+bool DuplicateFilter::insert(time_t timestamp, std::uint64_t hash) {
+    // 0 marks the empty slots.
+    if (hash == 0) {
+        hash = 1;
+    }
+    if (history.empty() || timestamp > largest_time) {
+        largest_time = timestamp;
+        evict();
+    }
+
+    auto index = find(hash);
+    if (slots[index].hash != 0) {
+        return false;
+    }
+    slots[index] = {hash, timestamp};
+    history.push_back({hash, timestamp});
+    charge_memory(MemoryUse::DuplicateFilter, sizeof(Slot));
+    if (++slot_num_used * 2 > slots.size()) {
+        grow();
+    }
+    return true;
+}
@@ -0,0 +1,366 @@
+/**
+ * Copyright [2020] Zhiyao Ma
+ *
+ * This module implements the external sort of the sort mode.
+ *
+ * The in-order executor appends every packet to the run being filled,
+ * whose texts are kept one after another in an arena. Once the run holds
+ * `run_size` bytes, it is handed to a background thread, which sorts it by
+ * the timestamp and spills it to a temporary file, while the executor
+ * fills the next run. At most `SORT_SPILLING_RUN_NUM` runs are spilled at
+ * a time, after which the executor waits for the oldest one.
+ *
+ * When the input ends, the runs are merged with a loser tree. If there are
+ * more than `SORT_MERGE_FAN_IN` of them, groups of consecutive runs are
+ * first merged into longer runs, in parallel, until a single merge is
+ * enough. The runs open at once are also bounded by the file descriptors
+ * the process may open and by the memory of a run for their buffers, which
+ * may lower the fan-in and the number of parallel merges. The final merge
+ * writes to the output. If everything fits in one run, it is sorted in
+ * memory and written out without touching the disk.
+ *
+ * The sort is stable. Each run is sorted stably, and ties between runs are
+ * broken by the order of the runs, which is the order of the input.
+ */
+#include "external_sorter.hpp"
+#include "loser_tree.hpp"
+#include "memory_governor.hpp"
+#include "global_states.hpp"
+#include "exceptions.hpp"
+#include "parameters.hpp"
+#include "macros.hpp"
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+/// A packet in a run. Its text is kept in the arena of the run.
+struct SortEntry {
+    time_t timestamp;
+    std::size_t offset;
+    std::size_t size;
+};
+
+/// A run of packets in memory, in the order of the input until sorted.
+struct SortRun {
+    std::vector<SortEntry> entries;
+    std::string arena;
+    /// The memory accounted for the run.
+    std::size_t memory_size = 0;
+};
+
+/// The memory accounted for a packet in a run.
+static std::size_t packet_memory_size(std::size_t size) {
+    return size + sizeof(SortEntry);
+}
+
+RunFile::RunFile(const std::string &dir)
+    : path(dir + "/miutils-sort-XXXXXX") {
+    int fd = ::mkstemp(&path[0]);
+    if (fd < 0) {
+        throw UnexpectedCase(
+            "Failed to create a temporary file in \"" + dir + "\": "
+            + std::string(std::strerror(errno))
+        );
+    }
+    open(fd, "w");
+}
+
+RunFile::~RunFile() {
+    close();
+    if (!path.empty()) {
+        ::unlink(path.c_str());
+    }
+}
+
+/// Open the stream on the file descriptor, with a buffer accounted as the
+/// memory of the sort mode.
+void RunFile::open(int fd, const char *mode) {
+    file = ::fdopen(fd, mode);
+    if (file == nullptr) {
+        ::close(fd);
+        throw UnexpectedCase(
+            "Failed to open a temporary file: "
+            + std::string(std::strerror(errno))
+        );
+    }
+    buffer.reset(new char[SORT_FILE_BUFFER_SIZE]);
+    std::setvbuf(file, buffer.get(), _IOFBF, SORT_FILE_BUFFER_SIZE);
+    charge_memory(MemoryUse::SortRuns, SORT_FILE_BUFFER_SIZE);
+}
+
+/// Close the stream, if open, and release its buffer. Return the result of
+/// fclose().
+int RunFile::close() {
+    if (file == nullptr) {
+        return 0;
+    }
+    auto result = std::fclose(file);
+    file = nullptr;
+    buffer.reset();
+    release_memory(MemoryUse::SortRuns, SORT_FILE_BUFFER_SIZE);
+    return result;
+}
+
+/// Append a packet to the file.
+void RunFile::write(time_t timestamp, const char *text, std::size_t size) {
+    if_unlikely (size > UINT32_MAX) {
+        throw UnexpectedCase("A packet is too large to be sorted.");
+    }
+    auto stamp = static_cast<std::int64_t>(timestamp);
+    auto length = static_cast<std::uint32_t>(size);
+    if_unlikely (std::fwrite(&stamp, sizeof(stamp), 1, file) != 1
+                 || std::fwrite(&length, sizeof(length), 1, file) != 1
+                 || std::fwrite(text, 1, size, file) != size) {
+        throw UnexpectedCase(
+            "Failed to write a temporary file: "
+            + std::string(std::strerror(errno))
+        );
+    }
+}
+
+/// Close the file after writing it.
+void RunFile::finish_writing() {
+    if (close() != 0) {
+        throw UnexpectedCase(
+            "Failed to write a temporary file: "
+            + std::string(std::strerror(errno))
+        );
+    }
+}
+
+/// Open the file to read it from the beginning. The file is unlinked right
+/// away, so it disappears once closed.
+void RunFile::start_reading() {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw UnexpectedCase(
+            "Failed to open a temporary file: "
+            + std::string(std::strerror(errno))
+        );
+    }
+    ::unlink(path.c_str());
+    path.clear();
+    open(fd, "r");
+}
+
+/// Read the next packet. Return false, and close the file, at the end of
+/// the file.
+bool RunFile::read(time_t &timestamp, std::string &text) {
+    std::int64_t stamp;
+    std::uint32_t length;
+    if (std::fread(&stamp, sizeof(stamp), 1, file) != 1) {
+        if_unlikely (std::ferror(file)) {
+            throw UnexpectedCase(
+                "Failed to read a temporary file: "
+                + std::string(std::strerror(errno))
+            );
+        }
+        close();
+        return false;
+    }
+    text.resize(0);
+    if_likely (std::fread(&length, sizeof(length), 1, file) == 1) {
+        text.resize(length);
+        if_likely (length == 0
+                   || std::fread(&text[0], 1, length, file) == length) {
+            timestamp = static_cast<time_t>(stamp);
+            return true;
+        }
+    }
+    throw UnexpectedCase("A temporary file of the sort mode is truncated.");
+}
+
+/// Sort the packets of the run by the timestamp, keeping the order of the
+/// input for ties.
+static void sort_run(SortRun &run) {
+    std::stable_sort(
+        run.entries.begin(), run.entries.end(),
+        [](const SortEntry &lhs, const SortEntry &rhs) {
+            return lhs.timestamp < rhs.timestamp;
+        }
+    );
+}
+
+/// Sort the run and write it to a new temporary file in the directory.
+static std::unique_ptr<RunFile> sort_and_spill(std::unique_ptr<SortRun> run,
+                                               std::string dir) {
+    sort_run(*run);
+    std::unique_ptr<RunFile> file(new RunFile(dir));
+    for (const auto &entry : run->entries) {
+        file->write(entry.timestamp, run->arena.data() + entry.offset,
+                    entry.size);
+    }
+    file->finish_writing();
+    release_memory(MemoryUse::SortRuns, run->memory_size);
+    return file;
+}
+
+/// Merge the runs, calling `emit(timestamp, text)` on every packet in
+/// order. Ties go to the earlier run.
+template <typename Emit>
+static void merge_runs(std::vector<std::unique_ptr<RunFile>> &files,
+                       Emit emit) {
+    struct Head {
+        time_t timestamp;
+        std::string text;
+        bool exhausted;
+    };
+    std::vector<Head> heads(files.size());
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        files[i]->start_reading();
+        heads[i].exhausted = !files[i]->read(heads[i].timestamp,
+                                             heads[i].text);
+    }
+    auto less = [&heads](int lhs, int rhs) {
+        if (heads[lhs].exhausted || heads[rhs].exhausted) {
+            return !heads[lhs].exhausted;
+        }
+        return heads[lhs].timestamp != heads[rhs].timestamp
+               ? heads[lhs].timestamp < heads[rhs].timestamp
+               : lhs < rhs;
+    };
+    LoserTree<decltype(less)> tree(static_cast<int>(files.size()), less);
+    while (true) {
+        auto i = tree.winner();
+        auto &head = heads[i];
+        if (head.exhausted) {
+            return;
+        }
+        emit(head.timestamp, head.text);
+        head.exhausted = !files[i]->read(head.timestamp, head.text);
+        tree.replay();
+    }
+}
+
+/// Merge the runs into a new temporary file in the directory.
+static std::unique_ptr<RunFile> merge_to_file(
+        std::vector<std::unique_ptr<RunFile>> files, std::string dir) {
+    std::unique_ptr<RunFile> merged(new RunFile(dir));
+    merge_runs(files, [&merged](time_t timestamp, const std::string &text) {
+        merged->write(timestamp, text.data(), text.size());
+    });
+    merged->finish_writing();
+    return merged;
+}
+
+ExternalSorter::ExternalSorter(std::size_t run_size_, std::string temp_dir_)
+    : run_size(run_size_), temp_dir(std::move(temp_dir_)),
+      run(new SortRun()) {}
+
+ExternalSorter::~ExternalSorter() {
+    // Wait for the spills still in progress, which use the runs.
+    spills.clear();
+}
+
+/// Wait for the oldest spill in progress, and keep its file.
+void ExternalSorter::finish_oldest_spill() {
+    auto spill = std::move(spills.front());
+    spills.pop_front();
+    run_files.push_back(spill.get());
+}
+
+/// Hand the run being filled to a background thread, which sorts it and
+/// spills it to a temporary file, and start a new run.
+void ExternalSorter::spill_run() {
+    while (spills.size() >= SORT_SPILLING_RUN_NUM) {
+        finish_oldest_spill();
+    }
+    spills.push_back(std::async(std::launch::async, sort_and_spill,
+                                std::move(run), temp_dir));
+    run.reset(new SortRun());
+}
+
+/// Add a packet to the sorter. Spill the run if it is full.
+void ExternalSorter::update(time_t timestamp, std::string &&str) {
+    auto memory_size = packet_memory_size(str.size());
+    charge_memory(MemoryUse::SortRuns, memory_size);
+    run->memory_size += memory_size;
+    run->entries.push_back({timestamp, run->arena.size(), str.size()});
+    run->arena.append(str);
+    if (run->memory_size >= run_size) {
+        spill_run();
+    }
+}
+
+/// Return the largest number of run files that may be open at once while
+/// merging. It is bounded by the file descriptors left to the process, and
+/// by the memory of a run, which is free by then, for their buffers.
+std::size_t ExternalSorter::merge_file_limit() const {
+    auto limit = run_size / SORT_FILE_BUFFER_SIZE;
+    struct rlimit fd_limit;
+    if (::getrlimit(RLIMIT_NOFILE, &fd_limit) == 0
+        && fd_limit.rlim_cur != RLIM_INFINITY) {
+        auto fd_num = fd_limit.rlim_cur > SORT_RESERVED_FD_NUM
+                      ? fd_limit.rlim_cur - SORT_RESERVED_FD_NUM : 0;
+        limit = std::min(limit, static_cast<std::size_t>(fd_num));
+    }
+    return std::max<std::size_t>(limit, 3);
+}
+
+/// Send all packets to the output in the order of their timestamps.
+void ExternalSorter::flush() {
+    // If nothing has been spilled, sort in memory.
+    if (spills.empty() && run_files.empty()) {
+        sort_run(*run);
+        for (const auto &entry : run->entries) {
+            g_output->write(run->arena.data() + entry.offset, entry.size);
+            g_output->put('\n');
+        }
+        release_memory(MemoryUse::SortRuns, run->memory_size);
+        run.reset(new SortRun());
+        return;
+    }
+
+    if (!run->entries.empty()) {
+        spill_run();
+    }
+    while (!spills.empty()) {
+        finish_oldest_spill();
+    }
+
+    // Each merge holds its runs and its output open. Fewer passes come
+    // first, and the files left over run merges in parallel.
+    auto file_limit = merge_file_limit();
+    auto fan_in = std::min(SORT_MERGE_FAN_IN, file_limit - 1);
+    auto parallel_merge_num = std::max<std::size_t>(
+        1, std::min(static_cast<std::size_t>(g_thread_num),
+                    file_limit / (fan_in + 1))
+    );
+
+    // Merge groups of consecutive runs in parallel, until all runs can be
+    // merged at once.
+    while (run_files.size() > fan_in) {
+        std::vector<std::unique_ptr<RunFile>> merged_files;
+        std::deque<std::future<std::unique_ptr<RunFile>>> merges;
+        for (std::size_t i = 0; i < run_files.size(); i += fan_in) {
+            if (merges.size() >= parallel_merge_num) {
+                merged_files.push_back(merges.front().get());
+                merges.pop_front();
+            }
+            auto first = run_files.begin() + i;
+            auto last = run_files.begin()
+                        + std::min(i + fan_in, run_files.size());
+            std::vector<std::unique_ptr<RunFile>> group(
+                std::make_move_iterator(first), std::make_move_iterator(last)
+            );
+            merges.push_back(std::async(std::launch::async, merge_to_file,
+                                        std::move(group), temp_dir));
+        }
+        while (!merges.empty()) {
+            merged_files.push_back(merges.front().get());
+            merges.pop_front();
+        }
+        run_files.swap(merged_files);
+    }
+
+    merge_runs(run_files, [](time_t timestamp, const std::string &text) {
+        g_output->write(text.data(), text.size());
+        g_output->put('\n');
+    });
+    run_files.clear();
+}
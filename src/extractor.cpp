@@ -3,7 +3,9 @@
  * 
  * This module implements a thread pool of extractors. Each extractor
  * runs on a Job structure. The Job structure contains a string, which
- * is a valid XML text string, and an associated sequence number.
+ * is a valid XML text string, and an associated sequence number. The jobs
+ * come in batches of consecutive ones, and all ordered tasks of a batch
+ * are provided to the in-order executor together.
  * 
  * Each extractor iterates through the `g_action_list`. When the predicate
  * function yields true, it calls the associated action function. For
@@ -13,14 +15,38 @@
  * function should print out the timestamp.
  * 
  * The splitter module acts as the job producer to all extractors.
+ * 
+ * Since the output is executed in order, an expensive job picked up late
+ * holds back all the jobs after it. The splitter estimates the cost of a
+ * batch by its size when producing it, and puts the expensive ones into a
+ * small express queue, which the extractors serve before anything else.
+ * An expensive batch thus starts ahead of the cheaper ones produced before
+ * it, and is more likely to be done by the time the in-order executor
+ * reaches it.
+ * 
+ * In the adaptive mode, `g_thread_num` extractor threads are started, but
+ * only the first `g_active_extractor_num` of them take new jobs, while the
+ * others are throttled. The splitter retunes that number periodically from
+ * the time it has been blocked on a full queue, which means the extractors
+ * fall behind, and the time the extractors have been parked on an empty
+ * queue, which means the splitter falls behind. It does not add extractors
+ * while the in-order executor is the bottleneck.
  */
 #include "extractor.hpp"
 #include "action_list.hpp"
+#include "in_order_executor.hpp"
+#include "memory_governor.hpp"
+#include "thread_placement.hpp"
 #include "global_states.hpp"
 #include "exceptions.hpp"
 #include "parameters.hpp"
 #include "macros.hpp"
-#include <queue>
+#include "job_queue.hpp"
+#include "work_stealing_deque.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include <mutex>
 #include <vector>
 #include <thread>
@@ -30,24 +56,33 @@
 #include <boost/property_tree/xml_parser.hpp>
 
 static void take_actions_on_input(Job job);
-static void smain_extractor();
+static void take_all_actions_on_tree(pt::ptree &&tree, Job &&job);
+static void smain_extractor(int worker_id);
 
-/// The mutex lock guarding all other static global variables.
+/// The mutex lock guarding the condition variables. It is only taken when
+/// a thread parks or wakes up a parked thread, never on the hot path.
 static std::mutex g_extractors_mtx;
 /// Thread objects that run extractor threads.
 static std::vector<std::thread> g_extractors;
 /// The number of alive extractor threads.
-static int g_alive_extractor_num = 0;
-/// The number of running extractor threads.
-static int g_running_extractor_num = 0;
+static std::atomic<int> g_alive_extractor_num(0);
+/// The number of running (not parked) extractor threads.
+static std::atomic<int> g_running_extractor_num(0);
 /// The flag indicating whether the splitter, which acts as the producer of
 /// the extractors, has finished its execution.
-static bool g_splitter_finished = false;
+static std::atomic<bool> g_splitter_finished(false);
 /// The flag indication whether an error has occured and we should stop
 /// all extractors prematurely.
-static bool g_early_terminating = false;
-/// The queue for storing pending jobs.
-static std::queue<Job> g_job_queue;
+static std::atomic<bool> g_early_terminating(false);
+/// The lock-free queue for storing pending jobs.
+static std::unique_ptr<MPMCQueue<JobBatch>> g_job_queue;
+/// The lock-free queue for expensive batches, which are served first.
+static std::unique_ptr<MPMCQueue<JobBatch>> g_express_queue;
+/// The work stealing deque of each extractor thread, indexed by the worker
+/// id. Each extractor moves a few consecutive batches from `g_job_queue`
+/// to its own deque, and steals from the others when both are empty.
+static std::vector<std::unique_ptr<WorkStealingDeque<JobBatch*>>>
+    g_worker_deques;
 /// The condition variable which is used to notify extractor threads that
 /// the job_queue has become non-empty.
 static std::condition_variable g_job_queue_nonempty_cv;
@@ -56,18 +91,65 @@ static std::condition_variable g_job_queue_nonempty_cv;
 /// become non-full.
 static std::condition_variable g_job_queue_nonfull_cv;
 /// The flag indicating whether the insertion to job_queue is pending.
-static bool g_insert_pending = false;
+static std::atomic<bool> g_insert_pending(false);
+/// Whether the number of active extractors is tuned at run time.
+static bool g_adaptive_extractor_num = false;
+/// Whether some action reads the XML tree, so that the packets are parsed.
+/// It is set from `g_action_list` when the extractors start.
+static bool g_tree_needed = true;
+/// The number of extractors taking new jobs. The extractors whose worker id
+/// is not less than it are throttled.
+static std::atomic<int> g_active_extractor_num(0);
+/// The number of throttled extractor threads.
+static std::atomic<int> g_throttled_extractor_num(0);
+/// The condition variable used to wake up throttled extractors.
+static std::condition_variable g_extractor_unthrottled_cv;
+/// The time in nanoseconds the extractors have spent parked on an empty
+/// queue, and the splitter has spent blocked on a full queue, since the
+/// last tuning.
+static std::atomic<long> g_extractor_idle_ns(0);
+static std::atomic<long> g_splitter_blocked_ns(0);
+/// The time of the last tuning.
+static std::chrono::steady_clock::time_point g_last_tuning_time;
+
+/// Return the nanoseconds elapsed since `start`.
+static long elapsed_ns(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+}
 
 /// Start the extractor threads. The number of extractor threads will
 /// be `g_thread_num`.
 void start_extractor() {
     std::lock_guard<std::mutex> guard(g_extractors_mtx);
     g_splitter_finished = false;
+    g_job_queue.reset(new MPMCQueue<JobBatch>(g_thread_num * FULL_WATRE_MARK));
+    g_express_queue.reset(
+        new MPMCQueue<JobBatch>(g_thread_num * EXPRESS_QUEUE_SIZE)
+    );
+    g_worker_deques.clear();
     for (int i = 0; i < g_thread_num; ++i) {
-        g_extractors.emplace_back(smain_extractor);
+        g_worker_deques.emplace_back(
+            new WorkStealingDeque<JobBatch*>(WORK_STEALING_BATCH)
+        );
     }
     g_alive_extractor_num = g_thread_num;
     g_running_extractor_num = g_thread_num;
+    g_active_extractor_num = g_adaptive_extractor_num
+                           ? std::min(THREAD_DEFAULT, g_thread_num)
+                           : g_thread_num;
+    g_throttled_extractor_num = 0;
+    g_tree_needed = std::any_of(g_action_list.begin(), g_action_list.end(),
+                                [](const ConditionalAction &action) {
+                                    return action.needs_tree;
+                                });
+    g_extractor_idle_ns = 0;
+    g_splitter_blocked_ns = 0;
+    g_last_tuning_time = std::chrono::steady_clock::now();
+    for (int i = 0; i < g_thread_num; ++i) {
+        g_extractors.emplace_back(smain_extractor, i);
+    }
 }
 
 /// Join all extractor threads.
@@ -78,6 +160,14 @@ void join_extractor() {
         }
     }
     g_extractors.clear();
+
+    // Free the jobs left behind if we have terminated prematurely.
+    JobBatch *batch;
+    for (auto &deque : g_worker_deques) {
+        while (deque->pop(batch)) {
+            delete batch;
+        }
+    }
 }
 
 /// Terminate all extractor threads prematurely.
@@ -86,6 +176,8 @@ void kill_extractor() {
     g_early_terminating = true;
     g_job_queue_nonfull_cv.notify_all();
     g_job_queue_nonempty_cv.notify_all();
+    g_extractor_unthrottled_cv.notify_all();
+    wake_memory_waiters();
 }
 
 /// Notify all extractors threads that the splitter, which acts as the
@@ -94,29 +186,99 @@ void notify_splitter_finished() {
     std::lock_guard<std::mutex> guard(g_extractors_mtx);
     g_splitter_finished = true;
     g_job_queue_nonempty_cv.notify_all();
+    g_extractor_unthrottled_cv.notify_all();
 }
 
-/// Add a new job to the extractors. This function may block if the
-/// `job_queue` is currently full.
-void produce_job_to_extractor(Job job) {
-    std::unique_lock<std::mutex> queue_lck(g_extractors_mtx);
+/// Tune the extractors in the adaptive mode.
+void enable_adaptive_extractor_num() {
+    g_adaptive_extractor_num = true;
+}
 
-    // If `g_job_queue` is full, we must wait.
+/// Retune the number of active extractors if `ADAPTIVE_THREAD_INTERVAL_MS`
+/// has passed since the last tuning. Only the splitter calls it.
+static void tune_extractor_num() {
+    auto interval_ns = elapsed_ns(g_last_tuning_time);
+    if (interval_ns < ADAPTIVE_THREAD_INTERVAL_MS * 1000000L) {
+        return;
+    }
+    g_last_tuning_time = std::chrono::steady_clock::now();
+    auto idle_ns = g_extractor_idle_ns.exchange(0);
+    auto blocked_ns = g_splitter_blocked_ns.exchange(0);
+    int active = g_active_extractor_num;
+
+    // More than one extractor's worth of idle time: the splitter cannot
+    // keep them busy, so give one back.
+    if (idle_ns > interval_ns && active > 1) {
+        g_active_extractor_num = active - 1;
+    // The splitter has been blocked on a full queue for a good part of the
+    // interval: add extractors, unless they would only wait for the
+    // in-order executor.
+    } else if (blocked_ns > interval_ns / 4 && active < g_thread_num
+               && !is_executor_backlogged()) {
+        g_active_extractor_num =
+            std::min(g_thread_num, active + std::max(1, active / 4));
+        std::lock_guard<std::mutex> guard(g_extractors_mtx);
+        g_extractor_unthrottled_cv.notify_all();
+    }
+}
+
+/// Block the splitter until the `g_job_queue` is no longer full. Spin for
+/// a while first, and park on the condition variable if it is still full.
+/// Return false if we should terminate prematurely.
+static bool wait_job_queue_nonfull() {
+    auto full_size =
+        static_cast<std::size_t>(g_active_extractor_num * FULL_WATRE_MARK);
+    for (int i = 0; i < SPIN_BEFORE_PARK; ++i) {
+        if (g_job_queue->size() < full_size) {
+            return true;
+        }
+        cpu_relax();
+    }
+
+    // Announce that we are about to park before checking the queue size
+    // again under the lock. The extractors pop first and then check this
+    // flag, so at least one side sees the other.
+    std::unique_lock<std::mutex> queue_lck(g_extractors_mtx);
+    g_insert_pending = true;
     g_job_queue_nonfull_cv.wait(
         queue_lck,
-        []{
-            g_insert_pending = true;
+        [full_size] {
             return g_splitter_finished || g_early_terminating
-                   || g_job_queue.size() < g_thread_num * FULL_WATRE_MARK;
+                   || g_job_queue->size() < full_size;
         }
     );
     g_insert_pending = false;
+    return !g_early_terminating;
+}
 
-    /// Terminate prematurely.
-    if_unlikely (g_early_terminating) {
-        return;
+/// Wake up parked extractors after a batch is pushed.
+static void wake_up_extractors() {
+    // Check if the there are sleeping worker threads. The fence pairs with
+    // the one in `park_extractor`, so that either we see the parked thread,
+    // or it sees the job we have just pushed.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (g_running_extractor_num + g_throttled_extractor_num
+        != g_alive_extractor_num) {
+        std::lock_guard<std::mutex> guard(g_extractors_mtx);
+        // If the splitter's producing speed is significantly larger than
+        // the consumption speed of executor threads, then we will eventually
+        // go into the `if` branch below. In such case, we should wake up
+        // all sleeping executor threads to achieve maximum performance.
+        if (g_job_queue->size()
+            > g_active_extractor_num * MIDDLE_WATER_MARK) {
+            g_job_queue_nonempty_cv.notify_all();
+        // Otherwise, we would better maintain a dynamic balance between
+        // the splitter thread and extractor threads, so we wake up one more
+        // extractor.
+        } else {
+            g_job_queue_nonempty_cv.notify_one();
+        }
     }
+}
 
+/// Add a new batch of jobs to the extractors. This function may block if
+/// the `job_queue` is currently full.
+void produce_job_to_extractor(JobBatch batch) {
     // If the splitter, which is the producer of all extractors, is set
     // to be finished execution, then this is an error.
     if_unlikely (g_splitter_finished) {
@@ -126,21 +288,188 @@ void produce_job_to_extractor(Job job) {
         );
     }
 
-    g_job_queue.emplace(std::move(job));
+    // If the memory budget is exceeded, we must wait until the consumers
+    // have freed some memory.
+    if_unlikely (!charge_job_memory(batch.xml_size, g_early_terminating)) {
+        return;
+    }
 
-    // Check if the there are sleeping worker threads.
-    if (g_running_extractor_num != g_alive_extractor_num) {
-        // If the splitter's producing speed is significantly larger than
-        // the consumption speed of executor threads, then we will eventually
-        // go into the `if` branch below. In such case, we should wake up
-        // all sleeping executor threads to achieve maximum performance.
-        if (g_job_queue.size() > g_thread_num * MIDDLE_WATER_MARK) {
-            g_job_queue_nonempty_cv.notify_all();
-        // Otherwise, we would better maintain a dynamic balance between
-        // the splitter thread and extractor threads, so we wake up one more
-        // extractor.
-        } else {
-            g_job_queue_nonempty_cv.notify_one();
+    if (g_adaptive_extractor_num) {
+        tune_extractor_num();
+    }
+
+    // Let an expensive batch overtake the cheaper ones waiting in the
+    // queue, as long as it is well within the horizon of the in-order
+    // executor. Otherwise the extractor taking it could wait there for a
+    // batch that nobody takes, since the extractors serve the express queue
+    // first. The memory governor may hold back every batch but the one
+    // being executed in the same way, so the jobs are strictly taken in
+    // order under a memory budget.
+    if (batch.xml_size >= EXPENSIVE_BATCH_SIZE && !is_memory_limited()
+        && is_batch_near_executor(batch.batch_num)
+        && g_express_queue->try_push(std::move(batch))) {
+        wake_up_extractors();
+        return;
+    }
+
+    // If `g_job_queue` is full, we must wait. The push may still fail
+    // right after a slot is freed, if the extractor that popped it has not
+    // released the cell yet. In such case simply retry.
+    if (g_job_queue->size() >= g_active_extractor_num * FULL_WATRE_MARK
+        || !g_job_queue->try_push(std::move(batch))) {
+        auto blocked_since = std::chrono::steady_clock::now();
+        do {
+            /// Terminate prematurely.
+            if_unlikely (!wait_job_queue_nonfull()) {
+                return;
+            }
+            cpu_relax();
+        } while (g_job_queue->size()
+                     >= g_active_extractor_num * FULL_WATRE_MARK
+                 || !g_job_queue->try_push(std::move(batch)));
+        g_splitter_blocked_ns += elapsed_ns(blocked_since);
+    }
+    wake_up_extractors();
+}
+
+/// Return true if some extractor is parked for lack of jobs.
+bool is_extractor_idle() {
+    return g_running_extractor_num.load(std::memory_order_relaxed)
+           + g_throttled_extractor_num.load(std::memory_order_relaxed)
+           != g_alive_extractor_num.load(std::memory_order_relaxed)
+           && g_job_queue->empty() && g_express_queue->empty();
+}
+
+/// Park the extractor until the `g_job_queue` becomes non-empty, or the
+/// splitter has finished, or we are terminating.
+static void park_extractor() {
+    auto parked_since = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> queue_lck(g_extractors_mtx);
+    --g_running_extractor_num;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    g_job_queue_nonempty_cv.wait(
+        queue_lck,
+        []{ return !g_job_queue->empty() || !g_express_queue->empty()
+                   || g_splitter_finished || g_early_terminating; }
+    );
+    ++g_running_extractor_num;
+    queue_lck.unlock();
+    if (g_adaptive_extractor_num) {
+        g_extractor_idle_ns += elapsed_ns(parked_since);
+    }
+}
+
+/// Park a throttled extractor until it becomes active again, or the
+/// splitter has finished, or we are terminating.
+static void throttle_extractor(int worker_id) {
+    std::unique_lock<std::mutex> queue_lck(g_extractors_mtx);
+    --g_running_extractor_num;
+    ++g_throttled_extractor_num;
+    g_extractor_unthrottled_cv.wait(
+        queue_lck,
+        [worker_id] { return worker_id < g_active_extractor_num
+                             || g_splitter_finished || g_early_terminating; }
+    );
+    --g_throttled_extractor_num;
+    ++g_running_extractor_num;
+}
+
+/// Move a few consecutive batches from the `g_job_queue` to the deque of
+/// the worker. They are pushed in reverse order, so that the owner, which
+/// pops from the bottom, processes them in ascending order, while thieves
+/// take the later ones from the top. Return false if the queue is empty.
+static bool refill_worker_deque(WorkStealingDeque<JobBatch*> &deque) {
+    JobBatch *batches[WORK_STEALING_BATCH];
+    int cnt = 0;
+    JobBatch batch;
+    while (cnt < WORK_STEALING_BATCH && g_job_queue->try_pop(batch)) {
+        batches[cnt++] = new JobBatch(std::move(batch));
+    }
+    if (cnt == 0) {
+        return false;
+    }
+
+    // If the queue is almost empty and the splitter is sleeping,
+    // we should wake up the splitter. The fence pairs with the store of
+    // `g_insert_pending` in `wait_job_queue_nonfull`, which is followed by
+    // the splitter checking the queue size, so that either we see the flag,
+    // or the splitter sees our pops.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (g_insert_pending
+        && g_job_queue->size()
+           <= g_active_extractor_num * LOW_WATER_MARK) {
+        std::lock_guard<std::mutex> guard(g_extractors_mtx);
+        g_job_queue_nonfull_cv.notify_one();
+    }
+
+    while (cnt > 0) {
+        deque.push(batches[--cnt]);
+    }
+    return true;
+}
+
+/// Try to steal a batch from the deque of other workers, starting from the
+/// next one of ourselves.
+static bool steal_job(int worker_id, JobBatch *&batch) {
+    for (int i = 1; i < g_thread_num; ++i) {
+        auto victim = (worker_id + i) % g_thread_num;
+        if (g_worker_deques[victim]->steal(batch)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Get the next batch for the worker, in the order of the
+/// `g_express_queue`, its own deque, the `g_job_queue` and the deques of
+/// other workers. Spin for a while first, and park if all of them stay
+/// empty. Return false if there will be no more job, either because the
+/// splitter has finished and the queue is drained, or because we are
+/// terminating. The batches remaining in the deques of other workers will
+/// be finished by their owners.
+static bool consume_job(int worker_id, std::unique_ptr<JobBatch> &batch) {
+    auto &deque = *g_worker_deques[worker_id];
+    JobBatch *pbatch;
+    JobBatch express_batch;
+    while (true) {
+        // Read the finish flag before trying to pop, so that a failed pop
+        // after seeing the flag means the queue is drained.
+        bool splitter_finished = g_splitter_finished;
+        bool throttled = false;
+        for (int i = 0; i < SPIN_BEFORE_PARK && !throttled; ++i) {
+            if_unlikely (g_early_terminating) {
+                return false;
+            }
+            if_unlikely (g_express_queue->try_pop(express_batch)) {
+                batch.reset(new JobBatch(std::move(express_batch)));
+                return true;
+            }
+            if (deque.pop(pbatch)) {
+                batch.reset(pbatch);
+                return true;
+            }
+            // A throttled extractor finishes its own deque first, and then
+            // stops taking new jobs.
+            if_unlikely (worker_id >= g_active_extractor_num
+                         && !splitter_finished) {
+                throttle_extractor(worker_id);
+                throttled = true;
+                continue;
+            }
+            if (refill_worker_deque(deque)) {
+                continue;
+            }
+            if (steal_job(worker_id, pbatch)) {
+                batch.reset(pbatch);
+                return true;
+            }
+            if (splitter_finished) {
+                return false;
+            }
+            cpu_relax();
+        }
+        if (!throttled) {
+            park_extractor();
         }
     }
 }
@@ -168,74 +497,65 @@ static void notify_main_thread() {
 }
 
 // The entrance function for sub(threads) running extractors.
-static void smain_extractor() {
+static void smain_extractor(int worker_id) {
     try {
-        std::unique_lock<std::mutex> queue_lck(g_extractors_mtx,
-                                               std::defer_lock);
-        while (true) {
-            queue_lck.lock();
-
-            // If all jobs are finished, exit the thread. Notify the main
-            // thread when the last extractor thread exits.
-            if (g_splitter_finished && g_job_queue.empty()) {
-                if (--g_alive_extractor_num == 0) {
-                    queue_lck.unlock();
-                    notify_main_thread();
-                }
-                return;
-            }
-
-            // If the `g_job_queue` is empty but the splitter is still producing
-            // new jobs, wait.
-            if (g_job_queue.empty()) {
-                --g_running_extractor_num;
-                g_job_queue_nonempty_cv.wait(
-                    queue_lck,
-                    []{ return !g_job_queue.empty() || g_splitter_finished
-                               || g_early_terminating; }
-                );
-                ++g_running_extractor_num;
-            }
-
-            // Terminate prematurely.
-            if_unlikely (g_early_terminating) {
-                return;
-            }
-
-            // If `g_job_queue` is empty, we woke from the above wait function
-            // because `g_splitter_finished` was `true`. Since the splitter
-            // has stop producing and the `g_job_queue` is empty, we should exit
-            // the thread. Notify the main thread when the last extractor
-            // thread exits.
-            if (g_job_queue.empty()) {
-                if (--g_alive_extractor_num == 0) {
-                    queue_lck.unlock();
-                    notify_main_thread();
-                }
-                return;
+        pin_current_thread(ThreadRole::Extractor, worker_id);
+        std::unique_ptr<JobBatch> batch;
+        while (consume_job(worker_id, batch)) {
+            // Each job provides one sequence number, or `g_fanout_width`
+            // consecutive ones in fanout mode.
+            long width = std::max(g_fanout_width, 1);
+            begin_ordered_batch(batch->batch_num,
+                                batch->jobs.front().job_num * width,
+                                (batch->jobs.back().job_num + 1) * width);
+            for (auto &job : batch->jobs) {
+                take_actions_on_input(std::move(job));
             }
+            end_ordered_batch();
+            release_memory(MemoryUse::Jobs, batch->xml_size);
+        }
 
-            // Consume a job from the queue and take actions.
-            auto job = std::move(g_job_queue.front());
-            g_job_queue.pop();
-
-            // If the queue is almost empty and the splitter is sleeping,
-            // we should wake up the splitter.
-            if (g_job_queue.size() <= g_thread_num * LOW_WATER_MARK
-                && g_insert_pending) {
-                g_insert_pending = false;
-                g_job_queue_nonfull_cv.notify_one();
-            }
+        // Terminate prematurely.
+        if_unlikely (g_early_terminating) {
+            return;
+        }
 
-            queue_lck.unlock();
-            take_actions_on_input(std::move(job));
+        // All jobs are finished. Notify the main thread when the last
+        // extractor thread exits.
+        if (--g_alive_extractor_num == 0) {
+            notify_main_thread();
         }
     } catch (...) {
         propagate_exeption_to_main();
     }
 }
 
+/// Run every action in the fanout part of the action list whose predicate
+/// yields true on the tree. Each of the first `g_fanout_width` actions
+/// produces exactly one ordered task, keyed by the pair (job_num, action
+/// index) flattened to `job_num * g_fanout_width + action_index`, so that
+/// the sequence numbers seen by the in-order executor stay consecutive.
+///
+/// Note that the tree and the job are handed to every action as rvalue
+/// references. Extract actions only read them, so they stay intact across
+/// calls, and the job only has its sequence number swapped in for each.
+static void take_all_actions_on_tree(pt::ptree &&tree, Job &&job) {
+    auto job_num = job.job_num;
+    for (int i = 0; i < g_fanout_width; ++i) {
+        auto &conditional_action = g_action_list[i];
+        auto seq_num = job_num * g_fanout_width + i;
+        if (conditional_action.predicate(tree, job)) {
+            job.job_num = seq_num;
+            conditional_action.action(std::move(tree), std::move(job));
+            job.job_num = job_num;
+        } else {
+            insert_ordered_task(seq_num);
+        }
+    }
+}
+
 /// Scan through the action list. Take according action when the first
+/// predicate function yields true. In fanout mode, take all actions whose
 /// predicate function yields true.
 static void take_actions_on_input(Job job) {
     // Save the job information for exception message.
@@ -245,10 +565,18 @@ static void take_actions_on_input(Job job) {
 
     try {
         // Convert the input string to an input stream and then
-        // build the property tree.
-        std::stringstream stream(job.xml_string);
+        // build the property tree, unless no action reads it.
         pt::ptree tree;
-        pt::read_xml(stream, tree);
+        if (g_tree_needed) {
+            std::stringstream stream(job.xml_string);
+            pt::read_xml(stream, tree);
+        }
+
+        // In fanout mode, run every matching action on the same tree.
+        if (g_fanout_width > 0) {
+            take_all_actions_on_tree(std::move(tree), std::move(job));
+            return;
+        }
 
         // Scan through the action list.
         for (auto &i : g_action_list) {
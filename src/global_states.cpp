@@ -1,5 +1,6 @@
 /* Copyright [2019] Zhiyao Ma */
 #include "global_states.hpp"
+#include <iterator>
 
 /// Parameter: the number of extractor thread
 int g_thread_num = 4;
@@ -11,9 +12,26 @@ std::vector<std::string> g_input_file_names;
 std::vector< std::unique_ptr<std::istream,
              std::function<void(std::istream*)>> > g_inputs;
 
-/// Parameter: output file stream.
-std::unique_ptr<std::ostream,
-                std::function<void(std::ostream*)> > g_output;
+/// Parameter: output file streams. There is exactly one stream unless the
+/// fanout mode is enabled, in which case each enabled extractor owns one.
+std::vector< std::unique_ptr<std::ostream,
+             std::function<void(std::ostream*)>> > g_outputs;
+
+/// The output stream that ordered tasks write to.
+std::ostream *g_output = nullptr;
+
+/// The stream that ordered tasks write warnings to.
+std::unique_ptr<std::ostream> g_error_output;
+
+/// Parameter: the number of actions that run on every packet in fanout mode.
+/// It is 0 if fanout mode is disabled.
+int g_fanout_width = 0;
+
+/// Parameter: whether the output is written without ordering.
+bool g_unordered = false;
+
+/// Parameter: whether the input files are merged by timestamps.
+bool g_merge_inputs = false;
 
 /// The global exception pointer.
 std::exception_ptr g_pexcept = nullptr;
@@ -55,8 +73,17 @@ std::string g_latest_seen_ts_string;
 /// The packet sorter.
 std::unique_ptr<ReorderWindow> g_reorder_window;
 
-/// The regular expression object used to match against packet type.
-std::regex g_packet_type_regex;
+/// The hashes of the packets seen in the content-based deduplication.
+std::unique_ptr<DuplicateFilter> g_duplicate_filter;
+
+/// The packet sorter of the sort mode.
+std::unique_ptr<ExternalSorter> g_external_sorter;
+
+/// The disorder profile of the profile-disorder mode.
+std::unique_ptr<DisorderProfile> g_disorder_profile;
+
+/// The packet type matcher used in the filter mode.
+std::unique_ptr<PacketTypeFilter> g_packet_type_filter;
 
 /// Sub threads call this function to propagate caught exception to the
 /// main thread. It changes the main state to Error and set the exception
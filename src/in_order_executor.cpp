@@ -7,53 +7,456 @@
  * producer for this in-order executor. Each task provided is associated with
  * a sequence number. If they happen to arrive out-of-order, e.g. some tasks
  * with larger sequence numbers arrive before those with smaller ones, they
- * will be temporarily buffered in the queue. In other words, provided tasks
+ * will be temporarily buffered in the ring. In other words, provided tasks
  * are executed in strict ascending order of the sequence number, e.g. i-th,
  * (i+1)-th, (i+2)-th...
  * 
  * Note that the producer to this module MUST guarantee that the provided
  * sequence number is consecutive.
+ * 
+ * The producers work on batches of consecutive jobs. The tasks of a batch
+ * are collected by the producing thread into a chain, and the chain is
+ * provided to the executor as a whole, under the sequence number of the
+ * batch. Consecutive tasks without a state update going to the same stream
+ * are merged on the way, so a batch of stateless packets usually becomes a
+ * single task.
+ * 
+ * Since the batch numbers are dense, the pending chains are kept in a
+ * fixed capacity ring indexed by `batch_num % capacity`, rather than in a
+ * priority queue. A producer publishes its chain into its own slot with a
+ * release store, and the executor drains contiguous ready slots without
+ * taking any lock. The mutex and condition variables are only used to park
+ * and wake up threads.
+ * 
+ * The batches pending in the executor are bounded by a horizon. A producer
+ * whose batch number is more than `g_task_horizon` ahead of the next batch
+ * to be executed waits until the executor catches up. The batch holding
+ * back the executor is always within the horizon, so it never waits, and
+ * the memory held by pending tasks does not grow with the skew of packet
+ * costs. If a memory budget is set, the texts of the pending tasks are
+ * accounted, and every producer except the one providing the next batch to
+ * be executed also waits while the budget is exceeded.
+ * 
+ * Tasks are allocated from a pool owned by the producing thread. After
+ * execution, the executor pushes the task back to the lock-free return
+ * stack of its pool, where the owner picks it up again. In the steady
+ * state, no memory is allocated between the extractors and the executor.
+ * 
+ * The executor only appends to the buffered output streams. The buffered
+ * output is flushed to the output writer when it gets stale, either while
+ * the executor keeps running or while it is sleeping.
+ * 
+ * With positioned output, which needs that no task carries a state update
+ * and that the output is a regular file, the executor does not even copy
+ * the output. The size of the output of each
+ * task is known once it is provided, so the executor only keeps a running
+ * sum of the sizes, which gives the offset of each task in the file, and
+ * queues the task with its offset. The extractors take the queued tasks
+ * after providing each batch and write them with pwrite(), in parallel and
+ * in any order. The executor writes the queued tasks itself before it
+ * sleeps, and when the queue is full, so that no output is held back. A
+ * queued task stays accounted against the memory budget until it is
+ * written.
+ * 
+ * In the unordered mode, the producers bypass the ring and write each batch
+ * to the output streams themselves, under a lock, once it is collected.
+ * Every output line is prefixed by its job number, so that the order can be
+ * restored afterwards. The executor thread then only flushes the stale
+ * output.
  */
 #include "in_order_executor.hpp"
+#include "output_writer.hpp"
+#include "memory_governor.hpp"
+#include "thread_placement.hpp"
 #include "global_states.hpp"
+#include "job_queue.hpp"
 #include "exceptions.hpp"
+#include "parameters.hpp"
+#include "macros.hpp"
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
 #include <condition_variable>
+#include <cstring>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
 #include <vector>
 
-/// The priority queue to guarantee in-order execution.
-static std::priority_queue<OrderedTask,
-                           std::vector<OrderedTask>,
-                           std::greater<OrderedTask>> g_pending_task;
-/// The mutex lock that guards on all static global variables.
+/// Clear the buffer of a recycled task. Release its memory if it has grown
+/// too large.
+static void clear_task_buffer(std::string &buffer) {
+    if_unlikely (buffer.capacity() > TASK_BUFFER_KEEP_SIZE) {
+        std::string().swap(buffer);
+    } else {
+        buffer.clear();
+    }
+}
+
+/// A pool of ordered tasks owned by a producer thread.
+class TaskPool {
+    /// All tasks ever allocated by the pool.
+    std::vector<std::unique_ptr<OrderedTask>> tasks;
+    /// The free list, only accessed by the owner thread.
+    OrderedTask *free_head = nullptr;
+    /// The stack of tasks returned by the executor or by the threads that
+    /// wrote them. The owner takes the whole stack at once, so there is no
+    /// ABA problem.
+    std::atomic<OrderedTask*> returned_head;
+
+ public:
+    TaskPool() : returned_head(nullptr) {}
+
+    /// Get an empty task. Only the owner thread may call it.
+    OrderedTask *acquire() {
+        if (free_head == nullptr) {
+            free_head = returned_head.exchange(
+                nullptr, std::memory_order_acquire
+            );
+        }
+        OrderedTask *task;
+        if_likely (free_head != nullptr) {
+            task = free_head;
+            free_head = task->next;
+            clear_task_buffer(task->output);
+            clear_task_buffer(task->error);
+            clear_task_buffer(task->payload);
+        } else {
+            tasks.emplace_back(new OrderedTask());
+            task = tasks.back().get();
+            task->pool = this;
+        }
+        return task;
+    }
+
+    /// Give an unused task back to the pool. Only the owner thread may call
+    /// it.
+    void recycle(OrderedTask *task) {
+        task->update.reset();
+        task->next = free_head;
+        free_head = task;
+    }
+
+    /// Give the task back to the pool. Any thread other than the owner may
+    /// call it.
+    void release(OrderedTask *task) {
+        task->update.reset();
+        auto head = returned_head.load(std::memory_order_relaxed);
+        do {
+            task->next = head;
+        } while (!returned_head.compare_exchange_weak(
+            head, task, std::memory_order_release, std::memory_order_relaxed
+        ));
+    }
+};
+
+/// A slot in the ring holding the tasks of a batch.
+struct TaskSlot {
+    /// Whether `task` has been published and is waiting for execution.
+    std::atomic<bool> ready;
+    /// The first task of the chain linked by `OrderedTask::next`, or nullptr
+    /// if there is nothing to be executed.
+    OrderedTask *task;
+    /// The memory accounted for the chain.
+    std::size_t memory_size;
+};
+
+/// The batch whose tasks are being collected by a producer thread.
+struct OrderedBatch {
+    /// The sequence number of the batch.
+    long batch_num = -1;
+    /// The sequence number of the next task expected in the batch.
+    long next_seq_num = 0;
+    /// The sequence number following the last task of the batch.
+    long end_seq_num = 0;
+    /// The first and the last task of the chain.
+    OrderedTask *head = nullptr;
+    OrderedTask *tail = nullptr;
+};
+
+/// A task whose output is written at a known offset of the output file.
+struct PositionedWrite {
+    OrderedTask *task;
+    long offset;
+};
+
+/// The pools of all producer threads. They live until the program exits,
+/// since their tasks may still be pending after the producers exit.
+static std::vector<std::unique_ptr<TaskPool>> g_task_pools;
+/// The mutex lock guarding `g_task_pools`.
+static std::mutex g_task_pools_mtx;
+/// The pool of the calling thread.
+static thread_local TaskPool *t_task_pool = nullptr;
+/// The batch being collected by the calling thread.
+static thread_local OrderedBatch t_batch;
+
+/// The ring of pending batches, indexed by `batch_num & g_task_ring_mask`.
+static std::unique_ptr<TaskSlot[]> g_task_ring;
+/// The capacity of `g_task_ring` minus 1. The capacity is a power of 2.
+static long g_task_ring_mask = 0;
+/// The largest distance between the sequence number of a batch being
+/// provided and that of the next batch to be executed. It is less than the
+/// capacity of `g_task_ring`.
+static long g_task_horizon = 0;
+/// The mutex lock used to park and wake up threads.
 static std::mutex g_pending_task_mtx;
-/// The condition variable used to notify that the priority queue has
-/// just become non-empty.
+/// The condition variable used to notify that the batch of the next
+/// sequence number has just become ready.
 static std::condition_variable g_pending_task_nonempty_cv;
-/// The sequence number of the next task to be executed.
-static long g_next_task_num = 0;
+/// The condition variable used to notify producers that the executor has
+/// advanced and freed some slots.
+static std::condition_variable g_task_ring_nonfull_cv;
+/// The sequence number of the next batch to be executed.
+static std::atomic<long> g_next_batch_num(0);
 /// The flag indicating whether the in-order executor should exit prematurely.
-static bool g_early_terminating = false;
+static std::atomic<bool> g_early_terminating(false);
 /// The flag indicating whether all the extractors, which act as the
 /// producer to the in-order executor, has exited.
-static bool g_no_more_task = false;
+static std::atomic<bool> g_no_more_task(false);
 /// The thread object of the in-order executor.
 static std::thread g_executor_thread;
 /// The flag indicating if the executor thread is sleeping.
-static bool g_executor_sleeping = false;
+static std::atomic<bool> g_executor_sleeping(false);
+/// The number of producers waiting for a free slot.
+static std::atomic<int> g_waiting_producer_num(0);
+/// The mutex lock guarding the output streams in the unordered mode.
+static std::mutex g_unordered_output_mtx;
+/// The file descriptor the output is written to at given offsets, or -1 if
+/// the output goes through the output streams.
+static int g_positioned_fd = -1;
+/// The offset of the output of the next task in the file. It is only
+/// accessed by the executor.
+static long g_output_offset = 0;
+/// The tasks waiting to be written at their offsets.
+static std::unique_ptr<MPMCQueue<PositionedWrite>> g_positioned_writes;
+
+/// Return true if the batch of `batch_num` may be provided now. It must be
+/// within the horizon of the executor, and unless it is the next batch to be
+/// executed, the memory budget must not be exceeded.
+static bool is_batch_admissible(long batch_num) {
+    auto distance = batch_num - g_next_batch_num;
+    return distance <= g_task_horizon
+           && (distance == 0 || !is_memory_exhausted());
+}
+
+/// Wait until the batch of `batch_num` may be provided.
+static void wait_task_horizon(long batch_num) {
+    for (int i = 0; i < SPIN_BEFORE_PARK; ++i) {
+        if (is_batch_admissible(batch_num)) {
+            return;
+        }
+        cpu_relax();
+    }
+
+    std::unique_lock<std::mutex> lck(g_pending_task_mtx);
+    ++g_waiting_producer_num;
+    g_task_ring_nonfull_cv.wait(
+        lck,
+        [batch_num] {
+            return g_early_terminating || is_batch_admissible(batch_num);
+        }
+    );
+    --g_waiting_producer_num;
+}
+
+/// Return true if some producer is waiting for the in-order executor to
+/// catch up.
+bool is_executor_backlogged() {
+    return g_waiting_producer_num > 0;
+}
+
+/// Return true if the batch is within half of the horizon.
+bool is_batch_near_executor(long batch_num) {
+    return batch_num - g_next_batch_num <= g_task_horizon / 2;
+}
 
-/// Provide a task associated with a sequence number to the in-order
-/// executor. Note that the producer to this module MUST guarantee that the
+/// Get an empty task from the pool of the calling thread. The pool is
+/// created on the first call of each thread.
+OrderedTask *acquire_ordered_task() {
+    if_unlikely (t_task_pool == nullptr) {
+        std::lock_guard<std::mutex> guard(g_task_pools_mtx);
+        g_task_pools.emplace_back(new TaskPool());
+        t_task_pool = g_task_pools.back().get();
+    }
+    return t_task_pool->acquire();
+}
+
+/// Start collecting the tasks of a batch on the calling thread. The batch
+/// covers the sequence numbers in [first_seq_num, end_seq_num).
+void begin_ordered_batch(long batch_num, long first_seq_num,
+                         long end_seq_num) {
+    if_unlikely (t_batch.batch_num >= 0) {
+        throw ProgramBug("A batch of ordered tasks is begun twice.");
+    }
+    t_batch.batch_num = batch_num;
+    t_batch.next_seq_num = first_seq_num;
+    t_batch.end_seq_num = end_seq_num;
+    t_batch.head = nullptr;
+    t_batch.tail = nullptr;
+}
+
+/// Return the memory accounted for the task while it is pending.
+static std::size_t task_memory_size(const OrderedTask &task) {
+    return task.output.size() + task.error.size() + task.payload.size();
+}
+
+/// Write the output of the task at its offset, and give the task and its
+/// memory back.
+static void write_positioned_task(const PositionedWrite &write) {
+    auto task = write.task;
+    write_output_at(g_positioned_fd, task->output.data(),
+                    task->output.size(), write.offset);
+    release_memory(MemoryUse::Tasks, task_memory_size(*task));
+    task->pool->release(task);
+}
+
+/// Write all the tasks waiting in the queue at their offsets.
+static void write_positioned_tasks() {
+    PositionedWrite write;
+    while (g_positioned_writes->try_pop(write)) {
+        write_positioned_task(write);
+    }
+}
+
+/// Provide a sequence number which has nothing to be executed.
+void insert_ordered_task(long seq_num) {
+    insert_ordered_task(seq_num, nullptr);
+}
+
+/// Prefix every line of the text with the job number and a tab.
+static void prefix_job_num(std::string &text, long job_num) {
+    static thread_local std::string prefixed;
+    auto prefix = std::to_string(job_num) + '\t';
+    prefixed.clear();
+    std::size_t start = 0;
+    while (start < text.size()) {
+        auto end = text.find('\n', start);
+        end = end == std::string::npos ? text.size() : end + 1;
+        prefixed += prefix;
+        prefixed.append(text, start, end - start);
+        start = end;
+    }
+    text.swap(prefixed);
+}
+
+/// Write the tasks of the batch collected on the calling thread to the
+/// output streams right away, and give them back to the pool.
+static void write_unordered_batch() {
+    std::lock_guard<std::mutex> guard(g_unordered_output_mtx);
+    auto task = t_batch.head;
+    while (task != nullptr) {
+        if_unlikely (task->update) {
+            throw ProgramBug(
+                "A task with a state update is provided in the unordered "
+                "mode."
+            );
+        }
+        auto next = task->next;
+        auto output = g_fanout_width > 0
+                    ? g_outputs[task->stream_index].get() : g_output;
+        if (!task->error.empty()) {
+            g_error_output->write(task->error.data(), task->error.size());
+        }
+        if (!task->output.empty()) {
+            output->write(task->output.data(), task->output.size());
+        }
+        t_task_pool->recycle(task);
+        task = next;
+    }
+    flush_output_if_stale();
+}
+
+/// Add a task associated with a sequence number to the batch of the calling
+/// thread. Note that the producer to this module MUST guarantee that the
 /// provided sequence number is consecutive.
-void insert_ordered_task(long seq_num, std::function<void()> func) {
-    std::lock_guard<std::mutex> guard(g_pending_task_mtx);
-    if (seq_num == g_next_task_num && g_executor_sleeping) {
-        g_executor_sleeping = false;
+void insert_ordered_task(long seq_num, OrderedTask *task) {
+    if_unlikely (seq_num != t_batch.next_seq_num
+                 || seq_num >= t_batch.end_seq_num) {
+        throw ProgramBug(
+            "The sequence number provided to the in-order executor is "
+            "not consecutive or is out of the current batch."
+        );
+    }
+    ++t_batch.next_seq_num;
+    if (task == nullptr) {
+        return;
+    }
+
+    task->stream_index = g_fanout_width > 0 ? seq_num % g_fanout_width : 0;
+    task->next = nullptr;
+    if (g_unordered && !task->output.empty()) {
+        prefix_job_num(task->output,
+                       g_fanout_width > 0 ? seq_num / g_fanout_width
+                                          : seq_num);
+    }
+    auto tail = t_batch.tail;
+    if (tail == nullptr) {
+        t_batch.head = task;
+        t_batch.tail = task;
+        return;
+    }
+
+    // Without a state update in between, writing two tasks one after the
+    // other is the same as writing their concatenation.
+    if (!tail->update && !task->update
+        && tail->stream_index == task->stream_index) {
+        tail->error.append(task->error);
+        tail->output.append(task->output);
+        t_task_pool->recycle(task);
+        return;
+    }
+    tail->next = task;
+    t_batch.tail = task;
+}
+
+/// Provide the tasks of the batch collected on the calling thread to the
+/// in-order executor. This function may block if the batch is too far
+/// ahead of the one being executed.
+void end_ordered_batch() {
+    auto batch_num = t_batch.batch_num;
+    if_unlikely (batch_num < 0
+                 || t_batch.next_seq_num != t_batch.end_seq_num) {
+        throw ProgramBug(
+            "A batch of ordered tasks is ended without providing "
+            "all of its sequence numbers."
+        );
+    }
+    t_batch.batch_num = -1;
+
+    if (g_unordered) {
+        write_unordered_batch();
+        return;
+    }
+
+    if_unlikely (!is_batch_admissible(batch_num)) {
+        wait_task_horizon(batch_num);
+    }
+
+    auto &slot = g_task_ring[batch_num & g_task_ring_mask];
+    slot.task = t_batch.head;
+    slot.memory_size = 0;
+    if (is_memory_limited()) {
+        for (auto task = t_batch.head; task != nullptr; task = task->next) {
+            slot.memory_size += task_memory_size(*task);
+        }
+        charge_memory(MemoryUse::Tasks, slot.memory_size);
+    }
+    slot.ready.store(true, std::memory_order_release);
+
+    // Wake up the executor if it is waiting for this batch. The fence pairs
+    // with the one in the executor before it parks.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (g_executor_sleeping && batch_num == g_next_batch_num) {
+        std::lock_guard<std::mutex> guard(g_pending_task_mtx);
         g_pending_task_nonempty_cv.notify_one();
     }
-    g_pending_task.push({seq_num, func});
+
+    // Help writing the output whose offsets are known.
+    if (g_positioned_fd >= 0) {
+        write_positioned_tasks();
+    }
 }
 
 /// When the in-order executor has finished execution, it calls this funcion
@@ -79,60 +482,208 @@ static void notify_main_thread() {
     }
 }
 
+/// Return true if the batch of the next sequence number is ready.
+static bool is_next_task_ready() {
+    return g_task_ring[g_next_batch_num & g_task_ring_mask]
+        .ready.load(std::memory_order_acquire);
+}
+
+/// Wait until the next batch is ready, or the producers have exited, or we
+/// are terminating. Spin for a while first, and park if it is still not
+/// ready.
+static void wait_next_task() {
+    for (int i = 0; i < SPIN_BEFORE_PARK; ++i) {
+        if (is_next_task_ready() || g_no_more_task || g_early_terminating) {
+            return;
+        }
+        cpu_relax();
+    }
+
+    auto is_woken_up = [] {
+        return g_early_terminating || is_next_task_ready() || g_no_more_task;
+    };
+    // Do not leave the queued output to the producers, which may be
+    // sleeping as well.
+    if (g_positioned_fd >= 0) {
+        write_positioned_tasks();
+    }
+
+    std::unique_lock<std::mutex> lck(g_pending_task_mtx);
+    g_executor_sleeping = true;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // Do not hold back the buffered output for too long while sleeping.
+    if (is_output_pending()
+        && !g_pending_task_nonempty_cv.wait_for(
+            lck, std::chrono::milliseconds(OUTPUT_FLUSH_INTERVAL_MS),
+            is_woken_up)) {
+        lck.unlock();
+        flush_output();
+        lck.lock();
+    }
+    g_pending_task_nonempty_cv.wait(lck, is_woken_up);
+    g_executor_sleeping = false;
+}
+
+/// Write the texts of the task to the output, and then run its state update.
+static void execute_task(OrderedTask &task) {
+    // In fanout mode, direct the output to the stream of the action which
+    // produced the task.
+    if (g_fanout_width > 0) {
+        g_output = g_outputs[task.stream_index].get();
+    }
+    if (!task.error.empty()) {
+        g_error_output->write(task.error.data(), task.error.size());
+    }
+    if (!task.output.empty()) {
+        g_output->write(task.output.data(), task.output.size());
+    }
+    if (task.update) {
+        task.update(task);
+    }
+}
+
+/// Write the error of the task, and queue its output to be written at the
+/// current offset of the output file. Write it right away if the queue is
+/// full. The task is given back to its pool, and its memory to the
+/// governor, once it is written.
+static void position_task(OrderedTask *task) {
+    if_unlikely (task->update) {
+        throw ProgramBug(
+            "A task with a state update is provided while the output is "
+            "written at given offsets."
+        );
+    }
+    if (!task->error.empty()) {
+        g_error_output->write(task->error.data(), task->error.size());
+    }
+    if (task->output.empty()) {
+        release_memory(MemoryUse::Tasks, task_memory_size(*task));
+        task->pool->release(task);
+        return;
+    }
+    PositionedWrite write {task, g_output_offset};
+    g_output_offset += static_cast<long>(task->output.size());
+    if (!g_positioned_writes->try_push(std::move(write))) {
+        write_positioned_task(write);
+    }
+}
+
+/// In the unordered mode, flush the output streams when they get stale,
+/// until the producers have exited.
+static void flush_unordered_output() {
+    std::unique_lock<std::mutex> lck(g_pending_task_mtx);
+    while (!g_no_more_task && !g_early_terminating) {
+        g_pending_task_nonempty_cv.wait_for(
+            lck, std::chrono::milliseconds(OUTPUT_FLUSH_INTERVAL_MS)
+        );
+        lck.unlock();
+        {
+            std::lock_guard<std::mutex> guard(g_unordered_output_mtx);
+            flush_output_if_stale();
+        }
+        lck.lock();
+    }
+    if (!g_early_terminating) {
+        lck.unlock();
+        notify_main_thread();
+    }
+}
+
 /// The entrance function for the in-order executor.
 static void smain_in_order_executor() {
     try {
-        std::unique_lock<std::mutex> lck(g_pending_task_mtx);
+        pin_current_thread(ThreadRole::InOrderExecutor);
+
+        if (g_unordered) {
+            flush_unordered_output();
+            return;
+        }
         while (true) {
             // Wait if we currently have no more task to execute or we cannot
             // execute them in-order.
-            g_pending_task_nonempty_cv.wait(
-                lck,
-                [] {
-                    g_executor_sleeping = true;
-                    return
-                        g_early_terminating ||
-                        (!g_pending_task.empty() &&
-                        g_pending_task.top().seq_num == g_next_task_num) ||
-                        g_no_more_task;
-                }
-            );
-            g_executor_sleeping = false;
+            wait_next_task();
 
             // Check if we should exit prematuerly.
             if (g_early_terminating) {
                 return;
             }
 
-            // Check if the producer has exited.
-            if (g_no_more_task) {
-                // If we have finished all tasks, we should notify the main
-                // thread and exit now.
-                if (g_pending_task.empty()) {
-                    lck.unlock();
-                    notify_main_thread();
-                    return;
-                }
+            // Check if the producer has exited. Since the producers have
+            // published all their batches before exiting, if the next batch
+            // is still not ready, there will be no more task.
+            if (g_no_more_task && !is_next_task_ready()) {
                 // If we still have pending tasks, but they are out-of-order,
                 // they can never be executed in-order. We should throw an
                 // exception. This is a program bug.
-                if (g_pending_task.top().seq_num != g_next_task_num) {
-                    throw ProgramBug(
-                        "All extractors have finished execution. There will "
-                        "be no more task for the in-order executor. However "
-                        "The in-order executor still has pending tasks, but "
-                        "they are out-of-order. They can never be executed "
-                        "in-order."
-                    );
+                for (long i = 0; i <= g_task_ring_mask; ++i) {
+                    if (g_task_ring[i].ready) {
+                        throw ProgramBug(
+                            "All extractors have finished execution. There "
+                            "will be no more task for the in-order executor. "
+                            "However The in-order executor still has pending "
+                            "tasks, but they are out-of-order. They can never "
+                            "be executed in-order."
+                        );
+                    }
+                }
+
+                // Write the remaining output, and leave the file offset at
+                // its end, as if it were written sequentially.
+                if (g_positioned_fd >= 0) {
+                    write_positioned_tasks();
+                    if (::lseek(g_positioned_fd, g_output_offset, SEEK_SET)
+                        < 0) {
+                        throw UnexpectedCase(
+                            "Failed to seek the output file: "
+                            + std::string(std::strerror(errno))
+                        );
+                    }
+                }
+
+                // We have finished all tasks, we should notify the main
+                // thread and exit now.
+                notify_main_thread();
+                return;
+            }
+
+            // Execute in-order batches.
+            while (is_next_task_ready()) {
+                auto batch_num =
+                    g_next_batch_num.load(std::memory_order_relaxed);
+                auto &slot = g_task_ring[batch_num & g_task_ring_mask];
+
+                auto task = slot.task;
+                while (task != nullptr) {
+                    // Releasing the task overwrites its link.
+                    auto next = task->next;
+                    if (g_positioned_fd >= 0) {
+                        position_task(task);
+                    } else {
+                        execute_task(*task);
+                        task->pool->release(task);
+                    }
+                    task = next;
                 }
+                // The tasks written at their offsets stay accounted until
+                // they are written.
+                if (g_positioned_fd < 0) {
+                    release_memory(MemoryUse::Tasks, slot.memory_size);
+                }
+                slot.ready.store(false, std::memory_order_relaxed);
+                g_next_batch_num.store(batch_num + 1,
+                                       std::memory_order_release);
             }
 
-            // Execute in-order tasks.
-            while (!g_pending_task.empty() &&
-                g_pending_task.top().seq_num == g_next_task_num) {
-                g_pending_task.top().func();
-                g_pending_task.pop();
-                ++g_next_task_num;
+            flush_output_if_stale();
+
+            // Wake up the producers waiting for a free slot. The fence orders
+            // the store of `g_next_batch_num` before the load of the waiting
+            // count, or a producer registering itself could be missed while
+            // it still sees the old batch number.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (g_waiting_producer_num > 0) {
+                std::lock_guard<std::mutex> guard(g_pending_task_mtx);
+                g_task_ring_nonfull_cv.notify_all();
             }
         }
     } catch (...) {
@@ -143,12 +694,43 @@ static void smain_in_order_executor() {
 /// Start the in-order executor.
 void start_in_order_executor() {
     std::lock_guard<std::mutex> guard(g_pending_task_mtx);
-    g_next_task_num = 0;
+
+    g_task_horizon = REORDER_HORIZON_PER_THREAD * g_thread_num;
+    long capacity = 2;
+    while (capacity <= g_task_horizon) {
+        capacity <<= 1;
+    }
+    g_task_ring.reset(new TaskSlot[capacity]);
+    g_task_ring_mask = capacity - 1;
+    for (long i = 0; i < capacity; ++i) {
+        g_task_ring[i].ready.store(false, std::memory_order_relaxed);
+    }
+
+    if (g_positioned_fd >= 0) {
+        g_positioned_writes.reset(
+            new MPMCQueue<PositionedWrite>(capacity)
+        );
+        g_output_offset = ::lseek(g_positioned_fd, 0, SEEK_CUR);
+        if (g_output_offset < 0) {
+            throw UnexpectedCase(
+                "Failed to seek the output file: "
+                + std::string(std::strerror(errno))
+            );
+        }
+    }
+
+    g_next_batch_num = 0;
     g_early_terminating = false;
     g_no_more_task = false;
     g_executor_thread = std::thread(smain_in_order_executor);
 }
 
+/// Write the output to the file descriptor at the offsets computed by the
+/// executor, instead of through the output streams.
+void enable_positioned_output(int fd) {
+    g_positioned_fd = fd;
+}
+
 /// Kill the in-order executor prematurely. Note that the thread is not
 /// joined in this function. One should call `join_in_order_executor`
 /// afterwards.
@@ -156,6 +738,7 @@ void kill_in_order_executor() {
     std::lock_guard<std::mutex> guard(g_pending_task_mtx);
     g_early_terminating = true;
     g_pending_task_nonempty_cv.notify_one();
+    g_task_ring_nonfull_cv.notify_all();
 }
 
 /// Notify the in-order executor that the extractors, which act as the
@@ -0,0 +1,188 @@
+/**
+ * Copyright [2020] Zhiyao Ma
+ *
+ * This module implements a compressor and a decompressor of the LZ4 block
+ * format, which is fast enough to run on every packet.
+ *
+ * A block is a sequence of sequences. Each sequence starts with a token,
+ * whose high 4 bits are the number of literals and low 4 bits are the
+ * match length minus 4. A field of 15 is continued by bytes of 255 and a
+ * final byte smaller than 255, all of them added up. The literals follow,
+ * then the 2-byte little endian offset of the match, and then the
+ * continuation of the match length. The last sequence has only literals,
+ * and the last 5 bytes of the data are always literals.
+ *
+ * The compressor is the greedy one: it looks up the last position of each
+ * 4-byte string in a hash table, and takes the match if the string is the
+ * same and within 64 KB. The table has about one slot per input byte, up
+ * to `HASH_BITS` bits, so that clearing it costs no more than reading a
+ * short packet.
+ */
+#include "lz4_block.hpp"
+#include "exceptions.hpp"
+#include "macros.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+/// The largest and the smallest number of bits of the hash of a 4-byte
+/// string.
+static constexpr int HASH_BITS = 12;
+static constexpr int MIN_HASH_BITS = 6;
+/// The shortest match.
+static constexpr std::size_t MIN_MATCH = 4;
+/// The number of bytes at the end which are always literals.
+static constexpr std::size_t LAST_LITERALS = 5;
+/// A match must start this many bytes before the end.
+static constexpr std::size_t MATCH_FIND_LIMIT = 12;
+/// The farthest offset of a match.
+static constexpr std::size_t MAX_DISTANCE = 65535;
+/// The position marking an empty slot of the hash table.
+static constexpr std::uint32_t NO_POSITION = UINT32_MAX;
+
+static std::uint32_t read32(const char *p) {
+    std::uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static std::uint32_t hash32(std::uint32_t value, int bits) {
+    return (value * 2654435761U) >> (32 - bits);
+}
+
+/// Append a length field continued from a token field of 15.
+static void append_length(std::string &dst, std::size_t length) {
+    while (length >= 255) {
+        dst.push_back(static_cast<char>(255));
+        length -= 255;
+    }
+    dst.push_back(static_cast<char>(length));
+}
+
+/// Append a sequence of the literals followed by a match, or only the
+/// literals if `match_length` is 0.
+static void append_sequence(std::string &dst, const char *literals,
+                            std::size_t literal_length, std::size_t offset,
+                            std::size_t match_length) {
+    auto match_code = match_length > 0 ? match_length - MIN_MATCH : 0;
+    auto token = (literal_length < 15 ? literal_length : 15) << 4
+               | (match_code < 15 ? match_code : 15);
+    dst.push_back(static_cast<char>(token));
+    if (literal_length >= 15) {
+        append_length(dst, literal_length - 15);
+    }
+    dst.append(literals, literal_length);
+    if (match_length == 0) {
+        return;
+    }
+    dst.push_back(static_cast<char>(offset & 0xff));
+    dst.push_back(static_cast<char>(offset >> 8));
+    if (match_code >= 15) {
+        append_length(dst, match_code - 15);
+    }
+}
+
+/// Compress the data into `dst` in the LZ4 block format.
+void compress_lz4_block(const char *src, std::size_t size,
+                        std::string &dst) {
+    static thread_local std::uint32_t table[1 << HASH_BITS];
+    dst.clear();
+    std::size_t anchor = 0;
+    if (size > MATCH_FIND_LIMIT) {
+        auto hash_bits = MIN_HASH_BITS;
+        while (hash_bits < HASH_BITS
+               && (std::size_t(1) << hash_bits) < size) {
+            ++hash_bits;
+        }
+        std::fill(table, table + (1 << hash_bits), NO_POSITION);
+        auto find_limit = size - MATCH_FIND_LIMIT;
+        auto match_limit = size - LAST_LITERALS;
+        std::size_t pos = 0;
+        while (pos < find_limit) {
+            auto sequence = read32(src + pos);
+            auto &slot = table[hash32(sequence, hash_bits)];
+            auto ref = slot;
+            slot = static_cast<std::uint32_t>(pos);
+            if (ref == NO_POSITION || pos - ref > MAX_DISTANCE
+                || read32(src + ref) != sequence) {
+                ++pos;
+                continue;
+            }
+            auto length = MIN_MATCH;
+            while (pos + length < match_limit
+                   && src[ref + length] == src[pos + length]) {
+                ++length;
+            }
+            append_sequence(dst, src + anchor, pos - anchor, pos - ref,
+                            length);
+            pos += length;
+            anchor = pos;
+        }
+    }
+    append_sequence(dst, src + anchor, size - anchor, 0, 0);
+}
+
+/// Read a length field continued from a token field of 15.
+static std::size_t read_length(const unsigned char *&ip,
+                               const unsigned char *end) {
+    std::size_t length = 0;
+    unsigned char byte;
+    do {
+        if_unlikely (ip == end) {
+            throw ProgramBug("A compressed LZ4 block is malformed.");
+        }
+        byte = *ip++;
+        length += byte;
+    } while (byte == 255);
+    return length;
+}
+
+/// Decompress the data in the LZ4 block format into `dst`.
+void decompress_lz4_block(const char *src, std::size_t size, char *dst,
+                          std::size_t original_size) {
+    auto ip = reinterpret_cast<const unsigned char *>(src);
+    auto end = ip + size;
+    std::size_t op = 0;
+    while (true) {
+        if_unlikely (ip == end) {
+            throw ProgramBug("A compressed LZ4 block is malformed.");
+        }
+        auto token = *ip++;
+        std::size_t literal_length = token >> 4;
+        if (literal_length == 15) {
+            literal_length += read_length(ip, end);
+        }
+        if_unlikely (literal_length > static_cast<std::size_t>(end - ip)
+                     || literal_length > original_size - op) {
+            throw ProgramBug("A compressed LZ4 block is malformed.");
+        }
+        std::memcpy(dst + op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+        if (ip == end) {
+            break;
+        }
+
+        if_unlikely (end - ip < 2) {
+            throw ProgramBug("A compressed LZ4 block is malformed.");
+        }
+        std::size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        std::size_t match_length = token & 15;
+        if (match_length == 15) {
+            match_length += read_length(ip, end);
+        }
+        match_length += MIN_MATCH;
+        if_unlikely (offset == 0 || offset > op
+                     || match_length > original_size - op) {
+            throw ProgramBug("A compressed LZ4 block is malformed.");
+        }
+        // The match may overlap the bytes being written.
+        for (std::size_t i = 0; i < match_length; ++i, ++op) {
+            dst[op] = dst[op - offset];
+        }
+    }
+    if_unlikely (op != original_size) {
+        throw ProgramBug("A compressed LZ4 block is malformed.");
+    }
+}
@@ -22,13 +22,21 @@
 #include "extractor.hpp"
 #include "splitter.hpp"
 #include "in_order_executor.hpp"
+#include "output_writer.hpp"
+#include "memory_governor.hpp"
+#include "thread_placement.hpp"
 #include "global_states.hpp"
 #include "exceptions.hpp"
 #include "parameters.hpp"
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <limits>
 #include <cstdlib>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <boost/type_index.hpp>
 #include <boost/property_tree/exceptions.hpp>
 #include <boost/program_options.hpp>
@@ -50,13 +58,14 @@ static void smain() {
     // Run the state machine. It will exit on InOrderExecutorFinished state.
     while (true) {
         switch (g_main_state) {
-        // Start all sub threads.
+        // Start all sub threads. Consumers are started before their
+        // producers, so that they are ready when the first job arrives.
         case MainState::Initializing:
             g_main_state = MainState::AllRunning;
             main_state_lck.unlock();
-            start_splitter();
-            start_extractor();
             start_in_order_executor();
+            start_extractor();
+            start_splitter();
             main_state_lck.lock();
             break;
         // All sub threads are running. Nothing to do. Just wait.
@@ -141,6 +150,99 @@ void show_exception_message(T &e) {
     recursive_print_exception(e);
 }
 
+/// Open the output file and append it to the global vector. The first
+/// opened file becomes the current output stream.
+static void open_output_file(const std::string &output) {
+    auto file = std::unique_ptr<std::ostream,
+                                std::function<void(std::ostream*)>>(
+        open_output_stream(output),
+        std::default_delete<std::ostream>()
+    );
+    if (file == nullptr) {
+        throw ArgumentError(
+                "Failed to open output file: "
+                + ("\"" + output + "\"")
+        );
+    }
+    g_outputs.emplace_back(std::move(file));
+    g_output = g_outputs.front().get();
+}
+
+/// Let the reorder window read the packets again from the input files, if
+/// they are all regular files, instead of holding their texts.
+static void open_reorder_window_inputs(bool has_input_files) {
+    if (!has_input_files) {
+        return;
+    }
+    std::vector<int> fds;
+    for (const auto &name : g_input_file_names) {
+        int fd = ::open(name.c_str(), O_RDONLY);
+        struct stat file_stat;
+        if (fd < 0 || ::fstat(fd, &file_stat) != 0
+            || !S_ISREG(file_stat.st_mode)) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            for (auto opened : fds) {
+                ::close(opened);
+            }
+            return;
+        }
+        fds.push_back(fd);
+    }
+    g_reorder_window->reference_inputs(std::move(fds));
+}
+
+/// Parse a memory size, which is a number of bytes optionally followed by
+/// a K, M or G suffix.
+static std::size_t parse_memory_size(const std::string &str) {
+    std::size_t pos = 0;
+    unsigned long long size = 0;
+    try {
+        size = std::stoull(str, &pos);
+    } catch (const std::exception &e) {
+        pos = 0;
+    }
+    if (pos == 0 || pos + 1 < str.size()) {
+        throw ArgumentError("Invalid memory size: \"" + str + "\"");
+    }
+    int shift = 0;
+    if (pos < str.size()) {
+        switch (str[pos]) {
+        case 'k': case 'K':
+            shift = 10;
+            break;
+        case 'm': case 'M':
+            shift = 20;
+            break;
+        case 'g': case 'G':
+            shift = 30;
+            break;
+        default:
+            throw ArgumentError("Invalid memory size: \"" + str + "\"");
+        }
+    }
+    if (size > std::numeric_limits<std::size_t>::max() >> shift) {
+        throw ArgumentError("Memory size out of range: \"" + str + "\"");
+    }
+    return static_cast<std::size_t>(size) << shift;
+}
+
+/// Parse the size of the reorder window in microseconds.
+static long parse_window_size(const std::string &str) {
+    std::size_t pos = 0;
+    long size = 0;
+    try {
+        size = std::stol(str, &pos);
+    } catch (const std::exception &e) {
+        pos = 0;
+    }
+    if (pos == 0 || pos < str.size()) {
+        throw ArgumentError("Invalid reorder window size: \"" + str + "\"");
+    }
+    return size;
+}
+
 /// Parse command line options and arguments, and set the global variables
 /// accordingly.
 static void parse_option(int argc, char **argv) {
@@ -150,10 +252,28 @@ static void parse_option(int argc, char **argv) {
     po::options_description visible_opts("Options");
     visible_opts.add_options()
         ("help,h", "Produce help message.\n")
-        ("thread,j", po::value<int>()->default_value(THREAD_DEFAULT),
-            "Set the thread number of the extractors.\n")
+        ("thread,j", po::value<std::string>()->default_value(
+                std::to_string(THREAD_DEFAULT)),
+            "Set the thread number of the extractors, or \"auto\" to "
+            "start one per usable CPU, limited by the CPU quota of the "
+            "cgroup, and keep only as many of them busy as the input "
+            "rate calls for.\n")
         ("output,o", po::value<std::string>(),
             "Set the output file name (default to stdout).\n")
+        ("max-memory", po::value<std::string>(),
+            "Limit the memory held by the buffered packets and output, "
+            "in bytes, optionally followed by K, M or G. When the limit is "
+            "exceeded, reading the input is held back until the buffered "
+            "data has been processed. It must be at least 64M. "
+            "(default to unlimited)\n")
+        ("pin",
+            "Pin the threads to the CPUs the process may run on. The "
+            "splitter and the in-order executor each get a dedicated CPU, "
+            "and the extractors are spread over the rest, filling the NUMA "
+            "node of the splitter first. The layout is printed to stderr.\n")
+        ("cpu-list", po::value<std::string>(),
+            "Pin the threads as \"pin\" does, but only to the given CPUs, "
+            "e.g. \"0-7,16-23\".\n")
         ("range", po::value<std::string>(),
             "Enable range mode. "
             "Set the timestamp range file path. Each line in the file "
@@ -188,12 +308,54 @@ static void parse_option(int argc, char **argv) {
             "\"pdcp_cipher_data_pdu.\"\n\n"
             "This option is mutially exclusive "
             "with the \"range\" mode.\n")
+        ("fanout",
+            "Enable fanout for the extract mode. Every enabled extractor "
+            "whose packet type matches runs on each packet, so that one "
+            "parse of the input serves all of them. Each extractor writes "
+            "to its own file named \"$output.$extractor\", thus the "
+            "\"output\" option must be set.\n")
+        ("merge",
+            "Merge the packets of all input files by their timestamps, "
+            "instead of reading the files one after another. Each input "
+            "file is read by its own thread, and should be sorted by "
+            "itself, e.g. by the \"reorder\" or \"sort\" mode. Packets "
+            "with equal timestamps are taken from the earlier file first.\n")
+        ("unordered",
+            "Write the output of each packet as soon as it is extracted, "
+            "instead of in the order of the input, with every line "
+            "prefixed by the job number of its packet and a tab. The job "
+            "number counts the packets from 0, so the order can be restored "
+            "by sorting the lines on it. It cannot be used with the "
+            "\"dedup\", \"reorder\" and \"sort\" modes, nor with "
+            "extractors that depend on preceding packets, namely "
+            "\"rrc_ota\", \"mac_rach_trigger\" and "
+            "\"action_pdcp_cipher_data_pdu\".\n")
+        ("positioned-output",
+            "Let the extractor threads write the output in parallel, each "
+            "packet at its offset in the output file, instead of having a "
+            "single thread copy all of it. The output must be a regular "
+            "file, not opened for appending nor shared with stderr. It "
+            "cannot be used with the \"fanout\" and \"unordered\" "
+            "options, nor with the modes and extractors that depend on "
+            "the preceding packets.\n")
         ("dedup",
             "Enable deduplicate mode.\n\n"
             "For each packet, it will be printed to the output if "
             "and only if its timestamp is no less than all previously "
-            "seen packets.\n")
-        ("reorder", po::value<long>(),
+            "seen packets.\n\n"
+            "It may be combined with the \"reorder\" mode, which then "
+            "deduplicates the packets leaving the reorder window, giving "
+            "the same output as running the two modes one after another "
+            "in a single pass.\n")
+        ("dedup-horizon", po::value<long>(),
+            "Deduplicate by the content of the packets instead, for the "
+            "\"dedup\" mode. Specify the horizon in microseconds.\n\n"
+            "A packet is dropped if and only if a packet with exactly the "
+            "same text has been seen, and the timestamps seen since have "
+            "not moved more than the horizon past it. Packets out of order "
+            "are kept. The horizon should cover the overlap of the chunks "
+            "being deduplicated.\n")
+        ("reorder", po::value<std::string>(),
             "Enable reorder mode. "
             "Specify the size of reorder window in microseconds.\n\n"
             "For each pair of packets P and Q, if P occurs before "
@@ -201,7 +363,33 @@ static void parse_option(int argc, char **argv) {
             "then it is a reverse pair. If the difference of the "
             "timestamp between P and Q is less than the given "
             "reorder window size, then Q is guaranteed to precede "
-            "P in the output.\n")
+            "P in the output.\n\n"
+            "If the size is \"auto\", the window starts at one second "
+            "and follows the disorder of the input, at twice the largest "
+            "inversion distance seen in the last 10 to 20 seconds of the "
+            "timestamps. It holds at most a quarter of the \"max-memory\" "
+            "limit if it is set, or 256M. The packets still out of order "
+            "in the output are reported at the end.\n")
+        ("compress-window",
+            "Compress the packets held in the reorder window with LZ4. It "
+            "only takes effect when the input cannot be read again, i.e. "
+            "from stdin or a pipe, since the window keeps only the "
+            "positions of the packets of regular files.\n")
+        ("sort",
+            "Enable sort mode. Sort all packets by their timestamp, "
+            "keeping the order of the input for equal timestamps, however "
+            "far apart they are. Packets are collected into runs in memory, "
+            "which are sorted and spilled to temporary files in $TMPDIR "
+            "(default to /tmp) and merged at the end. A run takes a quarter "
+            "of the \"max-memory\" limit if it is set, or 256M.\n")
+        ("profile-disorder",
+            "Enable profile-disorder mode. Measure how far the packets are "
+            "out of order, without writing them. For each packet older "
+            "than a packet before it, the inversion distance is the "
+            "difference of their timestamps. The percentiles and the "
+            "maximum of the distances are written to the output. The "
+            "maximum is the smallest \"reorder\" window that sorts the "
+            "input.\n")
         ("filter", po::value<std::string>(),
             "Enable filter mode. Specify the regular expression to "
             "match against the packet type string. The grammar of "
@@ -236,17 +424,53 @@ static void parse_option(int argc, char **argv) {
     /// If the --thread or -f option is set, set to the global variable
     /// accordingly. Otherwise set it to the default value.
     if (vm.count("thread")) {
-        g_thread_num = vm["thread"].as<int>();
-        /// If the thread number exceeds the limit, throw an exception.
-        if (g_thread_num <= 0 || g_thread_num > THREAD_LIMIT) {
-            throw ArgumentError(
-                "Invalid thread number. It should be between 1 and 256."
-            );
+        const auto &thread_str = vm["thread"].as<std::string>();
+        if (thread_str == "auto") {
+            g_thread_num = std::min(get_usable_cpu_num(), THREAD_LIMIT);
+            enable_adaptive_extractor_num();
+        } else {
+            std::size_t pos = 0;
+            try {
+                g_thread_num = std::stoi(thread_str, &pos);
+            } catch (const std::exception &e) {
+                pos = 0;
+            }
+            /// If the thread number exceeds the limit, throw an exception.
+            if (pos == 0 || pos != thread_str.size()
+                || g_thread_num <= 0 || g_thread_num > THREAD_LIMIT) {
+                throw ArgumentError(
+                    "Invalid thread number. It should be between 1 and 256, "
+                    "or \"auto\"."
+                );
+            }
         }
     } else {
         g_thread_num = THREAD_DEFAULT;
     }
 
+    /// If the --max-memory option is set, set the memory budget.
+    std::size_t budget = 0;
+    if (vm.count("max-memory")) {
+        budget = parse_memory_size(vm["max-memory"].as<std::string>());
+        if (budget < MIN_MEMORY_BUDGET) {
+            throw ArgumentError(
+                "The memory limit should be at least "
+                + std::to_string(MIN_MEMORY_BUDGET >> 20) + "M."
+            );
+        }
+        set_memory_budget(budget);
+    }
+
+    /// If the --pin or --cpu-list option is set, plan the thread placement
+    /// and report it.
+    if (vm.count("pin") || vm.count("cpu-list")) {
+        auto cpus = vm.count("cpu-list")
+                  ? parse_cpu_list(vm["cpu-list"].as<std::string>())
+                  : get_available_cpus();
+        set_thread_placement(cpus, g_thread_num);
+        std::cerr << describe_thread_placement();
+    }
+
     /// If we have any input argument, open the file and store it to the
     /// global vector.
     if (vm.count("input")) {
@@ -277,45 +501,82 @@ static void parse_option(int argc, char **argv) {
         g_input_file_names.emplace_back("stdin");
     }
 
-    /// If we have an output argument, open the file and store it to the
-    /// global variable.
-    if (vm.count("output")) {
-        const auto &output = vm["output"].as<std::string>();
-        auto file = std::unique_ptr<std::ostream,
-                                    std::function<void(std::ostream*)>>(
-            new std::ofstream(output),
-            std::default_delete<std::ostream>()
+    /// The compress-window option only works together with the reorder
+    /// mode.
+    if (vm.count("compress-window") && !vm.count("reorder")) {
+        throw ArgumentError(
+            "The \"compress-window\" option requires the \"reorder\" mode."
         );
-        if (file->fail()) {
+    }
+
+    /// If the --merge option is set, merge the input files by timestamps.
+    if (vm.count("merge")) {
+        g_merge_inputs = true;
+    }
+
+    /// The fanout option only works together with the extract mode, and
+    /// it needs the output file name to derive per-extractor file names.
+    if (vm.count("fanout")) {
+        if (!vm.count("extract")) {
+            throw ArgumentError(
+                "The \"fanout\" option requires the \"extract\" mode."
+            );
+        }
+        if (!vm.count("output")) {
             throw ArgumentError(
-                    "Failed to open output file: "
-                    + ("\"" + output + "\"")
+                "The \"fanout\" option requires the \"output\" option."
             );
         }
-        g_output = std::move(file);
+    /// If we have an output argument, open the file and store it to the
+    /// global variable.
+    } else if (vm.count("output")) {
+        open_output_file(vm["output"].as<std::string>());
     /// Otherwise, use stdout as the output file.
     } else {
         auto file = std::unique_ptr<std::ostream,
                                     std::function<void(std::ostream*)>>(
-            &std::cout,
-            [](std::ostream *p) {}
+            new OutputStream(STDOUT_FILENO, false),
+            std::default_delete<std::ostream>()
         );
-        g_output = std::move(file);
+        g_outputs.emplace_back(std::move(file));
+        g_output = g_outputs.back().get();
     }
 
+    g_error_output.reset(new OutputStream(STDERR_FILENO, false));
+
     // One and only one of the running mode must be set.
+    // The "dedup" mode only counts on its own, since it may be fused into
+    // the "reorder" mode.
     auto mode_cnt = vm.count("range") + vm.count("extract")
-                  + vm.count("dedup") + vm.count("reorder")
+                  + (vm.count("dedup") && !vm.count("reorder"))
+                  + vm.count("reorder")
+                  + vm.count("sort") + vm.count("profile-disorder")
                   + vm.count("filter");
     if(mode_cnt == 0) {
         throw ArgumentError(
             "None of the \"extract\", \"range\",  \"dedup\", "
-            "\"filter\" and \"reorder\" mode is enabled."
+            "\"filter\", \"reorder\", \"sort\" and \"profile-disorder\" "
+            "mode is enabled."
         );
     } else if (mode_cnt > 1) {
         throw ArgumentError(
             "Only one of the \"extract\", \"range\", \"dedup\", "
-            "\"filter\" and \"reorder\" mode can be enabled at a time."
+            "\"filter\", \"reorder\", \"sort\" and \"profile-disorder\" "
+            "mode can be enabled at a time, except that \"dedup\" may go "
+            "with \"reorder\"."
+        );
+    }
+
+    // The dedup-horizon option switches the dedup mode to compare the
+    // content of the packets.
+    if (vm.count("dedup-horizon")) {
+        if (!vm.count("dedup")) {
+            throw ArgumentError(
+                "The \"dedup-horizon\" option requires the \"dedup\" mode."
+            );
+        }
+        g_duplicate_filter.reset(
+            new DuplicateFilter(vm["dedup-horizon"].as<long>())
         );
     }
 
@@ -356,28 +617,146 @@ static void parse_option(int argc, char **argv) {
             start = end + 1;
         }
         initialize_action_list_with_extractors();
+
+        // In fanout mode, all actions except the trailing dummy one run on
+        // every packet. Open one output file for each of them.
+        if (vm.count("fanout")) {
+            g_fanout_width = g_action_list.size() - 1;
+            if (g_fanout_width == 0) {
+                throw ArgumentError(
+                    "The \"fanout\" option is set, but none of the given "
+                    "extractors is known."
+                );
+            }
+            // An extractor named twice would open its file twice, and the
+            // two streams would overwrite each other.
+            auto fanout_end = g_action_list.begin() + g_fanout_width;
+            for (auto it = g_action_list.begin(); it != fanout_end; ++it) {
+                if (std::any_of(g_action_list.begin(), it,
+                                [it](const ConditionalAction &action) {
+                                    return action.name == it->name;
+                                })) {
+                    throw ArgumentError(
+                        "The \"" + it->name + "\" extractor is given more "
+                        "than once in the \"fanout\" mode."
+                    );
+                }
+            }
+            const auto &output = vm["output"].as<std::string>();
+            for (int i = 0; i < g_fanout_width; ++i) {
+                open_output_file(output + "." + g_action_list[i].name);
+            }
+        }
     // If the dedup mode is enabled, setup the action list correspondingly.
-    } else if (vm.count("dedup")) {
+    } else if (vm.count("dedup") && !vm.count("reorder")) {
         initialize_action_list_to_dedup();
     // If the reorder mode is enabled, setup the reorder window
-    // and initialize the action list correspondingly.
+    // and initialize the action list correspondingly. With the dedup mode,
+    // the window also deduplicates the packets leaving it, unless they are
+    // deduplicated by content before entering it.
+    // A window sized automatically holds a share of the memory budget.
     } else if (vm.count("reorder")) {
-        auto size = vm["reorder"].as<long>();
-        g_reorder_window.reset(new ReorderWindow(size));
+        const auto &window = vm["reorder"].as<std::string>();
+        auto is_auto = window == "auto";
+        g_reorder_window.reset(new ReorderWindow(
+            is_auto ? REORDER_AUTO_INITIAL_WINDOW : parse_window_size(window)
+        ));
+        if (is_auto) {
+            g_reorder_window->enable_auto_size(
+                budget > 0 ? budget / REORDER_AUTO_BUDGET_SHARE
+                           : REORDER_AUTO_MEMORY_CAP
+            );
+        }
+        open_reorder_window_inputs(vm.count("input"));
+        if (vm.count("compress-window")
+            && !g_reorder_window->is_referencing_inputs()) {
+            g_reorder_window->enable_compression();
+        }
+        if (vm.count("dedup") && g_duplicate_filter == nullptr) {
+            g_reorder_window->enable_deduplication();
+        }
         initialize_action_list_to_reorder();
+    // If the sort mode is enabled, setup the external sorter, whose runs
+    // take a share of the memory budget if there is one.
+    } else if (vm.count("sort")) {
+        auto temp_dir = std::getenv("TMPDIR");
+        g_external_sorter.reset(new ExternalSorter(
+            budget > 0 ? budget / SORT_RUN_BUDGET_SHARE : SORT_RUN_SIZE,
+            temp_dir != nullptr && *temp_dir != '\0' ? temp_dir : "/tmp"
+        ));
+        initialize_action_list_to_sort();
+    // If the profile-disorder mode is enabled, setup the profile.
+    } else if (vm.count("profile-disorder")) {
+        g_disorder_profile.reset(new DisorderProfile());
+        initialize_action_list_to_profile_disorder();
     /// If the filter mode is enabled, setup the regular expression for
     /// matching against the packet type and initialize the action list
     /// accordingly.
     } else if (vm.count("filter")) {
         auto &&pattern = vm["filter"].as<std::string>();
-        g_packet_type_regex = pattern;
+        g_packet_type_filter.reset(new PacketTypeFilter(pattern));
         initialize_action_list_to_filter();
     } else {
         throw ProgramBug(
             "One and only one of the \"extract\", \"range\", \"dedup\", "
-            "\"filter\" and \"reorder\" mode should be set, but none is set."
+            "\"filter\", \"reorder\", \"sort\" and \"profile-disorder\" "
+            "mode should be set, but none is set."
         );
     }
+
+    /// The unordered output only works if no action depends on the order
+    /// of the packets.
+    if (vm.count("unordered")) {
+        for (const auto &action : g_action_list) {
+            if (action.stateful) {
+                throw ArgumentError(
+                    "The \"unordered\" option cannot be used with "
+                    + (action.name.empty()
+                       ? std::string(
+                             "the \"dedup\", \"reorder\", \"sort\" or "
+                             "\"profile-disorder\" mode")
+                       : "the \"" + action.name + "\" extractor")
+                    + ", which depends on the order of the packets."
+                );
+            }
+        }
+        g_unordered = true;
+    }
+
+    /// If the positioned-output option is set, let the extractors write the
+    /// output file at the offsets computed by the in-order executor. It
+    /// needs that no action updates a state, and a single output file.
+    if (vm.count("positioned-output")) {
+        if (g_unordered || g_fanout_width > 0) {
+            throw ArgumentError(
+                "The \"positioned-output\" option cannot be used with the "
+                "\"fanout\" or \"unordered\" option."
+            );
+        }
+        for (const auto &action : g_action_list) {
+            if (action.stateful) {
+                throw ArgumentError(
+                    "The \"positioned-output\" option cannot be used with "
+                    + (action.name.empty()
+                       ? std::string(
+                             "the \"dedup\", \"reorder\", \"sort\" or "
+                             "\"profile-disorder\" mode")
+                       : "the \"" + action.name + "\" extractor")
+                    + ", which depends on the order of the packets."
+                );
+            }
+        }
+        auto stream = dynamic_cast<OutputStream*>(g_output);
+        if (stream == nullptr
+            || !is_positionable_output(stream->file_descriptor())) {
+            throw ArgumentError(
+                "The \"positioned-output\" option requires the output to "
+                "be a regular file, not opened for appending nor shared "
+                "with stderr."
+            );
+        }
+        enable_positioned_output(stream->file_descriptor());
+    }
 }
 
 /// Do clean up work before exiting.
@@ -387,43 +766,61 @@ static void cleanup() {
     if (g_reorder_window != nullptr) {
         g_reorder_window->flush();
     }
+    /// If we are in the sort mode, merge the sorted runs to the output.
+    if (g_external_sorter != nullptr) {
+        g_external_sorter->flush();
+    }
+    /// If we are in the profile-disorder mode, write the summary.
+    if (g_disorder_profile != nullptr) {
+        g_disorder_profile->report(*g_output);
+    }
 }
 
 int main(int argc, char **argv) {
+    int exit_code = 0;
     try {
         parse_option(argc, argv);
+        start_output_writer();
         smain();
         cleanup();
     } catch (UnexpectedCase &e) {
         show_exception_message(e);
-        return 1;
+        exit_code = 1;
     } catch (ArgumentError &e) {
         show_exception_message(e);
-        return 1;
+        exit_code = 1;
     } catch (boost::program_options::error &e) {
         show_exception_message(e);
-        return 1;
+        exit_code = 1;
     } catch (boost::property_tree::ptree_bad_path &e) {
         show_exception_message(e);
-        return 1;
+        exit_code = 1;
     } catch (InputError &e) {
         show_exception_message(e);
-        return 1;
+        exit_code = 1;
     } catch (boost::property_tree::ptree_bad_data &e) {
         show_exception_message(e);
-        return 1;
+        exit_code = 1;
     } catch (boost::property_tree::ptree_error &e) {
         show_exception_message(e);
-        return 1;
+        exit_code = 1;
     } catch (ProgramBug &e) {
         show_exception_message(e);
-        return 1;
+        exit_code = 1;
     } catch (std::exception& e) {
         show_exception_message(e);
-        return 1;
+        exit_code = 1;
     } catch (...) {
         std::cerr << "Caught an unknown exception!" << std::endl;
     }
 
-    return 0;
+    // Write out the buffered output, even if we have failed half way.
+    try {
+        stop_output_writer();
+    } catch (std::exception &e) {
+        show_exception_message(e);
+        exit_code = 1;
+    }
+
+    return exit_code;
 }
@@ -0,0 +1,134 @@
+/**
+ * Copyright [2020] Zhiyao Ma
+ *
+ * This module implements the memory governor enforcing --max-memory.
+ *
+ * Every buffering point of the pipeline accounts the bytes it holds: the
+ * jobs between the splitter and the extractors, the tasks pending in the
+ * in-order executor, the reorder window, the runs of the sort mode and the
+ * output buffers. When the total exceeds the budget, the producer of each
+ * buffering point is held back, so that the consumers can catch up and
+ * free memory:
+ *
+ * - The splitter waits in `charge_job_memory` before producing a job.
+ * - An extractor waits before providing a task, unless it is the task the
+ *   in-order executor is waiting for.
+ * - The in-order executor waits for a returned output buffer instead of
+ *   allocating a new one.
+ *
+ * The runs of the sort mode are bounded by their own size, and are freed
+ * as soon as they are spilled to disk.
+ *
+ * The reorder window is only accounted. It is drained by the in-order
+ * executor, which never waits for memory, so that the pipeline always
+ * makes progress. If it exceeds the budget by itself, a single job is let
+ * in flight at a time, and a warning is given once.
+ */
+#include "memory_governor.hpp"
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+
+/// The memory budget in bytes, or 0 if unlimited.
+static std::size_t g_memory_budget = 0;
+/// The total memory accounted.
+static std::atomic<std::size_t> g_memory_usage(0);
+/// The memory accounted for each use.
+static std::atomic<std::size_t>
+    g_memory_usage_by_use[static_cast<int>(MemoryUse::NumberOfUses)];
+/// The mutex lock used to park and wake up the threads waiting for memory.
+static std::mutex g_memory_mtx;
+/// The condition variable used to notify that memory has been released.
+static std::condition_variable g_memory_released_cv;
+/// The number of threads waiting for memory.
+static std::atomic<int> g_memory_waiter_num(0);
+/// Whether the warning about the oversized reorder window has been given.
+static std::atomic<bool> g_window_warning_given(false);
+
+/// Set the memory budget in bytes. 0 means unlimited.
+void set_memory_budget(std::size_t budget) {
+    g_memory_budget = budget;
+}
+
+/// Return true if a memory budget is set.
+bool is_memory_limited() {
+    return g_memory_budget != 0;
+}
+
+/// Account the memory without waiting.
+void charge_memory(MemoryUse use, std::size_t bytes) {
+    if (g_memory_budget == 0) {
+        return;
+    }
+    g_memory_usage_by_use[static_cast<int>(use)] += bytes;
+    g_memory_usage += bytes;
+}
+
+/// Give back the memory accounted by `charge_memory`.
+void release_memory(MemoryUse use, std::size_t bytes) {
+    if (g_memory_budget == 0) {
+        return;
+    }
+    g_memory_usage_by_use[static_cast<int>(use)] -= bytes;
+    g_memory_usage -= bytes;
+
+    // The waiters announce themselves before checking the usage, so either
+    // we see the waiter, or it sees the released memory.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (g_memory_waiter_num > 0) {
+        std::lock_guard<std::mutex> guard(g_memory_mtx);
+        g_memory_released_cv.notify_all();
+    }
+}
+
+/// Return true if the accounted memory exceeds the budget.
+bool is_memory_exhausted() {
+    return g_memory_budget != 0 && g_memory_usage > g_memory_budget;
+}
+
+/// Return the memory accounted for the given use.
+std::size_t get_memory_usage(MemoryUse use) {
+    return g_memory_usage_by_use[static_cast<int>(use)];
+}
+
+/// Wait until a new job of `bytes` fits in the budget, and account it.
+bool charge_job_memory(std::size_t bytes,
+                       const std::atomic<bool> &early_terminating) {
+    if (g_memory_budget == 0) {
+        return !early_terminating;
+    }
+
+    auto fits = [bytes, &early_terminating] {
+        return early_terminating
+               || g_memory_usage + bytes <= g_memory_budget
+               || (get_memory_usage(MemoryUse::Jobs) == 0
+                   && get_memory_usage(MemoryUse::Tasks) == 0);
+    };
+    if (!fits()) {
+        std::unique_lock<std::mutex> lck(g_memory_mtx);
+        ++g_memory_waiter_num;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        g_memory_released_cv.wait(lck, fits);
+        --g_memory_waiter_num;
+    }
+    if (early_terminating) {
+        return false;
+    }
+
+    // The reorder window alone exhausting the budget lets only one job in
+    // flight at a time. It still makes progress, but on a single thread.
+    if (get_memory_usage(MemoryUse::ReorderWindow) > g_memory_budget
+        && !g_window_warning_given.exchange(true)) {
+        std::cerr << "Warning: the reorder window exceeds the memory limit by "
+                     "itself. The input is processed one batch at a time."
+                  << std::endl;
+    }
+    charge_memory(MemoryUse::Jobs, bytes);
+    return true;
+}
+
+/// Wake up the threads waiting in `charge_job_memory`.
+void wake_memory_waiters() {
+    std::lock_guard<std::mutex> guard(g_memory_mtx);
+    g_memory_released_cv.notify_all();
+}
@@ -0,0 +1,378 @@
+/**
+ * Copyright [2020] Zhiyao Ma
+ *
+ * This module implements the output stage.
+ *
+ * The in-order executor only appends to the output streams, which collect
+ * the text in large buffers in memory. A full buffer, or one that has been
+ * held back for too long, is handed to a dedicated writer thread. The
+ * writer takes all buffers queued at a time and writes those going to the
+ * same file with a single writev() call, so the number of system calls
+ * does not depend on the number of output lines.
+ *
+ * The buffers are recycled. Their number is bounded, so if the writer
+ * falls behind, the in-order executor blocks until a buffer is returned.
+ * It also waits for a returned buffer instead of allocating a new one if
+ * the memory budget is exceeded.
+ */
+#include "output_writer.hpp"
+#include "memory_governor.hpp"
+#include "thread_placement.hpp"
+#include "exceptions.hpp"
+#include "parameters.hpp"
+#include "macros.hpp"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// A filled buffer waiting to be written.
+struct OutputChunk {
+    int fd;
+    char *data;
+    std::size_t size;
+};
+
+/// All stream buffers ever created. They are created before the in-order
+/// executor starts, and live until the program exits.
+static std::vector<OutputBuffer*> g_output_buffers;
+/// The mutex lock guarding the states shared with the writer thread below.
+static std::mutex g_writer_mtx;
+/// The condition variable used to notify the writer thread that there are
+/// chunks to be written, or that it should exit.
+static std::condition_variable g_chunk_available_cv;
+/// The condition variable used to notify that a buffer has been returned.
+static std::condition_variable g_buffer_available_cv;
+/// The chunks waiting to be written, in the order of submission.
+static std::deque<OutputChunk> g_pending_chunks;
+/// The buffers ready for reuse.
+static std::vector<char*> g_free_buffers;
+/// The number of buffers allocated so far.
+static int g_buffer_num = 0;
+/// The flag indicating whether the writer thread should exit once all
+/// pending chunks are written.
+static bool g_writer_stopping = false;
+/// The exception raised by the writer thread. Once it is set, the
+/// remaining output is discarded.
+static std::exception_ptr g_write_error = nullptr;
+/// Whether `g_write_error` has been rethrown to a thread writing output.
+static bool g_write_error_thrown = false;
+/// The thread object of the output writer.
+static std::thread g_writer_thread;
+/// The last time all streams were flushed.
+static std::chrono::steady_clock::time_point g_last_flush_time;
+
+/// Get an empty buffer. Block if all buffers are in use.
+static char *acquire_output_buffer() {
+    std::unique_lock<std::mutex> lck(g_writer_mtx);
+    // Every stream may hold one buffer. Beyond that, a buffer is either
+    // free or being written, so waiting for one always succeeds.
+    auto stream_num = static_cast<int>(g_output_buffers.size());
+    if (g_free_buffers.empty()
+        && g_buffer_num < OUTPUT_BUFFER_NUM + stream_num
+        && (g_buffer_num <= stream_num || !is_memory_exhausted())) {
+        ++g_buffer_num;
+        lck.unlock();
+        charge_memory(MemoryUse::OutputBuffers, OUTPUT_BUFFER_SIZE);
+        return new char[OUTPUT_BUFFER_SIZE];
+    }
+    g_buffer_available_cv.wait(lck, [] { return !g_free_buffers.empty(); });
+    auto buffer = g_free_buffers.back();
+    g_free_buffers.pop_back();
+    return buffer;
+}
+
+/// Write all the buffers to the file, retrying on partial writes.
+static void write_all(int fd, iovec *iov, int iov_num) {
+    while (iov_num > 0) {
+        auto written = ::writev(fd, iov, iov_num);
+        if_unlikely (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw UnexpectedCase(
+                "Failed to write the output: "
+                + std::string(std::strerror(errno))
+            );
+        }
+        while (iov_num > 0
+               && static_cast<std::size_t>(written) >= iov->iov_len) {
+            written -= iov->iov_len;
+            ++iov;
+            --iov_num;
+        }
+        if (iov_num > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+            iov->iov_len -= written;
+        }
+    }
+}
+
+/// Write the chunks. Consecutive chunks going to the same file are written
+/// with one system call.
+static void write_chunks(const std::vector<OutputChunk> &chunks) {
+    std::vector<iovec> iov;
+    std::size_t i = 0;
+    while (i < chunks.size()) {
+        auto fd = chunks[i].fd;
+        iov.clear();
+        for (; i < chunks.size() && chunks[i].fd == fd
+               && iov.size() < IOV_MAX; ++i) {
+            iov.push_back({chunks[i].data, chunks[i].size});
+        }
+        write_all(fd, iov.data(), static_cast<int>(iov.size()));
+    }
+}
+
+/// The entrance function for the output writer.
+static void smain_output_writer() {
+    std::vector<OutputChunk> chunks;
+    std::unique_lock<std::mutex> lck(g_writer_mtx);
+    try {
+        pin_current_thread(ThreadRole::OutputWriter);
+    } catch (...) {
+        g_write_error = std::current_exception();
+    }
+    while (true) {
+        g_chunk_available_cv.wait(
+            lck,
+            [] { return !g_pending_chunks.empty() || g_writer_stopping; }
+        );
+        if (g_pending_chunks.empty()) {
+            return;
+        }
+        chunks.assign(g_pending_chunks.begin(), g_pending_chunks.end());
+        g_pending_chunks.clear();
+        bool failed = g_write_error != nullptr;
+        lck.unlock();
+
+        std::exception_ptr pexcept = nullptr;
+        if (!failed) {
+            try {
+                write_chunks(chunks);
+            } catch (...) {
+                pexcept = std::current_exception();
+            }
+        }
+
+        lck.lock();
+        if (pexcept != nullptr) {
+            g_write_error = pexcept;
+        }
+        for (auto &chunk : chunks) {
+            g_free_buffers.push_back(chunk.data);
+        }
+        g_buffer_available_cv.notify_all();
+    }
+}
+
+OutputBuffer::OutputBuffer(int fd_, bool owns_fd_)
+    : fd(fd_), owns_fd(owns_fd_) {
+    std::lock_guard<std::mutex> guard(g_writer_mtx);
+    g_output_buffers.push_back(this);
+}
+
+OutputBuffer::~OutputBuffer() {
+    delete[] pbase();
+    if (owns_fd) {
+        ::close(fd);
+    }
+}
+
+void OutputBuffer::submit() {
+    if (pptr() == pbase()) {
+        return;
+    }
+    OutputChunk chunk {fd, pbase(), static_cast<std::size_t>(pptr() - pbase())};
+    setp(nullptr, nullptr);
+
+    std::lock_guard<std::mutex> guard(g_writer_mtx);
+    if_unlikely (g_writer_stopping && !g_writer_thread.joinable()) {
+        throw ProgramBug("Output is written after the writer has stopped.");
+    }
+    if_unlikely (g_write_error != nullptr) {
+        g_free_buffers.push_back(chunk.data);
+        g_buffer_available_cv.notify_all();
+        if (!g_write_error_thrown) {
+            g_write_error_thrown = true;
+            std::rethrow_exception(g_write_error);
+        }
+        return;
+    }
+    g_pending_chunks.push_back(chunk);
+    g_chunk_available_cv.notify_one();
+}
+
+OutputBuffer::int_type OutputBuffer::overflow(int_type ch) {
+    submit();
+    auto buffer = acquire_output_buffer();
+    setp(buffer, buffer + OUTPUT_BUFFER_SIZE);
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+std::streamsize OutputBuffer::xsputn(const char *s, std::streamsize n) {
+    std::streamsize written = 0;
+    while (written < n) {
+        if (pptr() == epptr()) {
+            overflow(traits_type::eof());
+        }
+        auto len = std::min<std::streamsize>(n - written, epptr() - pptr());
+        std::memcpy(pptr(), s + written, len);
+        pbump(static_cast<int>(len));
+        written += len;
+    }
+    return n;
+}
+
+int OutputBuffer::sync() {
+    submit();
+    return 0;
+}
+
+OutputStream::OutputStream(int fd, bool owns_fd)
+    : std::ostream(nullptr), buffer(fd, owns_fd) {
+    rdbuf(&buffer);
+    // Let the errors raised by the writer propagate to the caller.
+    exceptions(std::ios::badbit);
+}
+
+/// Open the file for writing, truncating it. Return nullptr on failure.
+OutputStream *open_output_stream(const std::string &file_name) {
+    int fd = ::open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        return nullptr;
+    }
+    return new OutputStream(fd, true);
+}
+
+/// Return true if the output may be written to the file descriptor at
+/// given offsets.
+bool is_positionable_output(int fd) {
+    struct stat output_stat, error_stat;
+    if (::fstat(fd, &output_stat) != 0 || !S_ISREG(output_stat.st_mode)) {
+        return false;
+    }
+    auto flags = ::fcntl(fd, F_GETFL);
+    if (flags < 0 || (flags & O_APPEND)) {
+        return false;
+    }
+    // The writes to stderr would move the shared file offset.
+    return ::fstat(STDERR_FILENO, &error_stat) != 0
+           || error_stat.st_dev != output_stat.st_dev
+           || error_stat.st_ino != output_stat.st_ino;
+}
+
+/// Write the data to the file descriptor at the offset, retrying on partial
+/// writes, without moving the file offset.
+void write_output_at(int fd, const char *data, std::size_t size,
+                     long offset) {
+    while (size > 0) {
+        auto written = ::pwrite(fd, data, size, offset);
+        if_unlikely (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw UnexpectedCase(
+                "Failed to write the output: "
+                + std::string(std::strerror(errno))
+            );
+        }
+        data += written;
+        size -= written;
+        offset += written;
+    }
+}
+
+/// Start the output writer thread.
+void start_output_writer() {
+    std::lock_guard<std::mutex> guard(g_writer_mtx);
+    g_writer_stopping = false;
+    g_last_flush_time = std::chrono::steady_clock::now();
+    g_writer_thread = std::thread(smain_output_writer);
+}
+
+/// Hand the buffered output of all streams to the writer thread, wait until
+/// it is written, and join the writer thread.
+void stop_output_writer() {
+    if (!g_writer_thread.joinable()) {
+        return;
+    }
+
+    std::exception_ptr pexcept = nullptr;
+    try {
+        flush_output();
+    } catch (...) {
+        pexcept = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(g_writer_mtx);
+        g_writer_stopping = true;
+        g_chunk_available_cv.notify_one();
+    }
+    g_writer_thread.join();
+
+    std::lock_guard<std::mutex> guard(g_writer_mtx);
+    if (pexcept == nullptr && g_write_error != nullptr
+        && !g_write_error_thrown) {
+        g_write_error_thrown = true;
+        pexcept = g_write_error;
+    }
+    for (auto buffer : g_free_buffers) {
+        delete[] buffer;
+        release_memory(MemoryUse::OutputBuffers, OUTPUT_BUFFER_SIZE);
+    }
+    g_free_buffers.clear();
+    g_buffer_num = 0;
+    if (pexcept != nullptr) {
+        std::rethrow_exception(pexcept);
+    }
+}
+
+/// Hand the buffered output of all streams to the writer thread.
+void flush_output() {
+    for (auto buffer : g_output_buffers) {
+        buffer->pubsync();
+    }
+    g_last_flush_time = std::chrono::steady_clock::now();
+}
+
+/// Flush all streams if they have not been flushed for
+/// `OUTPUT_FLUSH_INTERVAL_MS` milliseconds.
+void flush_output_if_stale() {
+    auto now = std::chrono::steady_clock::now();
+    if (now - g_last_flush_time
+        < std::chrono::milliseconds(OUTPUT_FLUSH_INTERVAL_MS)) {
+        return;
+    }
+    if (is_output_pending()) {
+        flush_output();
+    } else {
+        g_last_flush_time = now;
+    }
+}
+
+/// Return true if any stream holds output not handed to the writer yet.
+bool is_output_pending() {
+    for (auto buffer : g_output_buffers) {
+        if (buffer->is_dirty()) {
+            return true;
+        }
+    }
+    return false;
+}
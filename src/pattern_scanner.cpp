@@ -0,0 +1,138 @@
+/**
+ * Copyright [2020] Zhiyao Ma
+ * 
+ * This module implements a multi-substring scanner.
+ * 
+ * Several actions search for fixed strings in the packets, e.g. the
+ * "Tracking area update accept" in the showname of NAS packets. Rather
+ * than running `std::string::find` once for each string over every node
+ * of the XML tree, the scanner compiles all strings into an Aho-Corasick
+ * automaton, and reports which of them occur, and where, in a single pass
+ * over the raw packet text.
+ * 
+ * The automaton is stored as a full transition table, so that each input
+ * byte costs exactly one table lookup.
+ * 
+ * The modules register the strings they search for when the program starts,
+ * and all of them are compiled into a single shared scanner on first use.
+ */
+
+#include "pattern_scanner.hpp"
+#include "exceptions.hpp"
+#include <algorithm>
+#include <queue>
+
+/// Whether the shared scanner has been built. It is constant initialized,
+/// so it may be read by the registrations run before `main`.
+static bool g_shared_scanner_built = false;
+
+/// The patterns registered for the shared scanner. The vector is created on
+/// first use, whatever the order of the static initializations.
+static std::vector<std::string> &registered_scan_patterns() {
+    static std::vector<std::string> patterns;
+    return patterns;
+}
+
+/// Register a pattern for the shared scanner and return its id.
+int register_scan_pattern(const std::string &pattern) {
+    if (g_shared_scanner_built) {
+        throw ProgramBug(
+            "Scan pattern \"" + pattern + "\" is registered after the "
+            "shared scanner is built."
+        );
+    }
+    auto &patterns = registered_scan_patterns();
+    auto it = std::find(patterns.begin(), patterns.end(), pattern);
+    if (it != patterns.end()) {
+        return static_cast<int>(it - patterns.begin());
+    }
+    patterns.push_back(pattern);
+    return static_cast<int>(patterns.size()) - 1;
+}
+
+/// Return the scanner of all registered patterns, building it on the first
+/// call.
+const PatternScanner &shared_pattern_scanner() {
+    static const PatternScanner scanner = [] {
+        g_shared_scanner_built = true;
+        return PatternScanner(registered_scan_patterns());
+    }();
+    return scanner;
+}
+
+/// Build the automaton from the patterns. The id of each pattern is its
+/// index in the vector.
+PatternScanner::PatternScanner(const std::vector<std::string> &patterns) {
+    // Build the trie. Missing transitions are marked with -1.
+    delta.assign(ALPHABET_SIZE, -1);
+    outputs.emplace_back();
+    for (int id = 0; id < static_cast<int>(patterns.size()); ++id) {
+        const auto &pattern = patterns[id];
+        if (pattern.empty()) {
+            throw ProgramBug("PatternScanner does not accept empty pattern.");
+        }
+        int state = 0;
+        for (unsigned char c : pattern) {
+            auto &next = delta[state * ALPHABET_SIZE + c];
+            if (next == -1) {
+                next = outputs.size();
+                outputs.emplace_back();
+                delta.insert(delta.end(), ALPHABET_SIZE, -1);
+            }
+            state = delta[state * ALPHABET_SIZE + c];
+        }
+        outputs[state].push_back(id);
+        lengths.push_back(pattern.size());
+    }
+
+    // Compute the failure links in BFS order and turn the trie into a
+    // complete DFA.
+    std::vector<int> fail(outputs.size(), 0);
+    std::queue<int> bfs;
+    for (int c = 0; c < ALPHABET_SIZE; ++c) {
+        auto &next = delta[c];
+        if (next == -1) {
+            next = 0;
+        } else {
+            bfs.push(next);
+        }
+    }
+    while (!bfs.empty()) {
+        auto state = bfs.front();
+        bfs.pop();
+        const auto &fail_outputs = outputs[fail[state]];
+        outputs[state].insert(outputs[state].end(),
+                              fail_outputs.begin(), fail_outputs.end());
+        for (int c = 0; c < ALPHABET_SIZE; ++c) {
+            auto &next = delta[state * ALPHABET_SIZE + c];
+            auto fail_next = delta[fail[state] * ALPHABET_SIZE + c];
+            if (next == -1) {
+                next = fail_next;
+            } else {
+                fail[next] = fail_next;
+                bfs.push(next);
+            }
+        }
+    }
+}
+
+/// Scan the text and record the first occurrence of each pattern. It stops
+/// early once all patterns have been found.
+void PatternScanner::scan(const char *text, std::size_t len,
+                          PatternMatches &matches) const {
+    matches.scanned = true;
+    matches.positions.assign(lengths.size(), std::string::npos);
+
+    std::size_t remaining = lengths.size();
+    int state = 0;
+    for (std::size_t i = 0; i < len && remaining > 0; ++i) {
+        state = delta[state * ALPHABET_SIZE
+                      + static_cast<unsigned char>(text[i])];
+        for (auto id : outputs[state]) {
+            if (matches.positions[id] == std::string::npos) {
+                matches.positions[id] = i + 1 - lengths[id];
+                --remaining;
+            }
+        }
+    }
+}
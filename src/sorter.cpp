@@ -7,11 +7,68 @@
  * The difference of the timestamps of the oldest and the newest
  * packet will not be greater than the out-of-order tolerance
  * value. Otherwise, the older one will be sent to output immediately.
+ * 
+ * The packets are kept in a flat binary heap ordered by the timestamp and
+ * then by the arrival order, so that packets with the same timestamp leave
+ * the window in the order they came in. The heap entries only refer to the
+ * texts, which are appended to a single arena. The texts sent to the
+ * output leave holes in the arena, and the arena is compacted once the
+ * holes take more than half of it. An arena whose capacity is far beyond
+ * the texts left is released on compaction, so the memory shrinks back
+ * after a burst.
+ * 
+ * If the input files are regular files, the texts need not be kept at all.
+ * The window then only keeps the offset and the length of each packet in
+ * its input file, and reads the text again with pread() when the packet is
+ * sent to the output. The packets leave the window shortly after they are
+ * read, so the texts are usually still in the page cache, and the window
+ * costs a few dozen bytes per packet, however large the packets are.
+ * 
+ * Otherwise, the texts may be compressed by the extractors before they are
+ * provided, and are decompressed when they leave the window.
+ * 
+ * The window may size itself by the disorder of the input. The inversion
+ * distance of a packet is how much older it is than the newest packet
+ * inserted before it. The window grows at once to a safety factor times
+ * any distance it sees, and shrinks to a safety factor times the largest
+ * distance of the current and the last epoch of the timestamps, so a
+ * burst of disorder is forgotten after two epochs. A packet more out of
+ * place than the window allows is still sent to the output, and such
+ * packets are counted and reported at the end. The memory held by the
+ * window is capped, beyond which the oldest packets are evicted early.
+ * 
+ * The window may also apply the rule of the deduplicate mode to the packets
+ * leaving it, so that reordering and deduplicating the overlapping chunks
+ * of a trace takes a single pass. The timestamp text of each packet is
+ * then kept after its text, for the message about a dropped packet, and
+ * the text of a dropped packet is never read or decompressed.
  */
 
 #include "sorter.hpp"
 #include "exceptions.hpp"
 #include "global_states.hpp"
+#include "memory_governor.hpp"
+#include "lz4_block.hpp"
+#include "parameters.hpp"
+#include "macros.hpp"
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+/// The memory accounted for a packet in the window, whose text of `size`
+/// bytes is kept in the window.
+static std::size_t packet_memory_size(std::size_t size) {
+    return size + 6 * sizeof(long) + 2 * sizeof(std::size_t);
+}
+
+/// The order of the heap, which puts the oldest packet on top.
+template <typename Entry>
+static bool is_newer(const Entry &lhs, const Entry &rhs) {
+    return lhs.timestamp != rhs.timestamp ? lhs.timestamp > rhs.timestamp
+                                          : lhs.seq_num > rhs.seq_num;
+}
 
 ReorderWindow::ReorderWindow(time_t ooo_tolerance_) {
     if (static_cast<long>(ooo_tolerance_) <= 0L) {
@@ -23,28 +80,214 @@ ReorderWindow::ReorderWindow(time_t ooo_tolerance_) {
     ooo_tolerance = ooo_tolerance_;
 }
 
-/// Send all remaining packets to the output in sequence.
+ReorderWindow::~ReorderWindow() {
+    for (auto fd : input_fds) {
+        ::close(fd);
+    }
+}
+
+/// Let the window size follow the disorder of the input.
+void ReorderWindow::enable_auto_size(std::size_t memory_cap_) {
+    auto_sizing = true;
+    memory_cap = memory_cap_;
+}
+
+/// Take over the file descriptors of the input files.
+void ReorderWindow::reference_inputs(std::vector<int> fds) {
+    input_fds = std::move(fds);
+}
+
+/// Read the text of a packet from its input file into the buffer.
+static void read_packet_text(int fd, long offset, std::size_t size,
+                             std::string &buffer) {
+    buffer.resize(size);
+    std::size_t done = 0;
+    while (done < size) {
+        auto got = ::pread(fd, &buffer[done], size - done, offset + done);
+        if_unlikely (got <= 0) {
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            throw UnexpectedCase(
+                "Failed to read a packet from the input file again: "
+                + std::string(got < 0 ? std::strerror(errno)
+                                      : "unexpected end of file")
+            );
+        }
+        done += got;
+    }
+}
+
+/// Send the oldest packet to the output and remove it from the window,
+/// unless it is dropped by the deduplication.
+void ReorderWindow::pop() {
+    std::pop_heap(heap.begin(), heap.end(), is_newer<Entry>);
+    const auto &entry = heap.back();
+    auto memory_size = packet_memory_size(entry.stored_size()
+                                          + entry.ts_size);
+    dead_size += entry.stored_size() + entry.ts_size;
+    held_size -= memory_size;
+    release_memory(MemoryUse::ReorderWindow, memory_size);
+    if (auto_sizing) {
+        if (entry.timestamp < last_output_time) {
+            ++late_packet_num;
+        }
+        last_output_time = std::max(last_output_time, entry.timestamp);
+    }
+    if (deduplicating) {
+        const auto *ts = arena.data() + entry.ts_offset;
+        if (entry.timestamp < g_latest_seen_timestamp) {
+            (*g_error_output) << "Dropping packet: ";
+            g_error_output->write(ts, entry.ts_size);
+            (*g_error_output) << " < " << g_latest_seen_ts_string << '\n';
+            heap.pop_back();
+            return;
+        }
+        g_latest_seen_timestamp = entry.timestamp;
+        g_latest_seen_ts_string.assign(ts, entry.ts_size);
+    }
+    if (entry.file_idx >= 0) {
+        read_packet_text(input_fds[entry.file_idx], entry.offset, entry.size,
+                         read_buffer);
+        g_output->write(read_buffer.data(), read_buffer.size());
+    } else if (entry.packed_size > 0) {
+        read_buffer.resize(entry.size);
+        decompress_lz4_block(arena.data() + entry.offset, entry.packed_size,
+                             &read_buffer[0], entry.size);
+        g_output->write(read_buffer.data(), read_buffer.size());
+    } else {
+        g_output->write(arena.data() + entry.offset, entry.size);
+    }
+    g_output->put('\n');
+    heap.pop_back();
+}
+
+/// Release the buffer if its capacity is far beyond `size`.
+static void release_oversized_arena(std::string &arena, std::size_t size) {
+    if (arena.capacity()
+        > REORDER_ARENA_SLACK_FACTOR * size + REORDER_ARENA_KEEP_SIZE) {
+        std::string().swap(arena);
+    }
+}
+
+/// Move the texts still in the window to the front of a fresh arena.
+void ReorderWindow::compact() {
+    release_oversized_arena(spare_arena, arena.size() - dead_size);
+    spare_arena.clear();
+    for (auto &entry : heap) {
+        if (entry.file_idx < 0) {
+            auto offset = static_cast<long>(spare_arena.size());
+            spare_arena.append(arena, entry.offset, entry.stored_size());
+            entry.offset = offset;
+        }
+        auto ts_offset = static_cast<long>(spare_arena.size());
+        spare_arena.append(arena, entry.ts_offset, entry.ts_size);
+        entry.ts_offset = ts_offset;
+    }
+    arena.swap(spare_arena);
+    release_oversized_arena(spare_arena, arena.size());
+    dead_size = 0;
+}
+
+/// Send all remaining packets to the output in sequence. Report the
+/// packets left out of order by the window sized automatically.
 void ReorderWindow::flush() {
-    for (auto &p : window) {
-        (*g_output) << p.second << std::endl;
+    while (!heap.empty()) {
+        pop();
+    }
+    std::string().swap(arena);
+    std::string().swap(spare_arena);
+    dead_size = 0;
+    if (auto_sizing && late_packet_num > 0) {
+        (*g_error_output) << "Warning: " << late_packet_num
+                          << " packets were more out of order than the "
+                             "automatically sized reorder window allowed, "
+                             "and are still out of order in the output. "
+                             "The largest inversion distance was "
+                          << largest_inversion << " microseconds.\n";
     }
-    window.clear();
 }
 
 /// Insert a new packet in to the window. Conditionally evict
 /// older packets to the output if the window size is exceeded.
-void ReorderWindow::update(time_t timestamp, std::string &&str) {
-    // Insert into the multimap with hint. Assume that most
-    // of the packets are in-sequence, so that we would better
-    // start searching the insertion point from the tail.
-    window.emplace_hint(window.end(), timestamp, str);
+void ReorderWindow::update(time_t timestamp, std::string &&record,
+                           std::size_t ts_size) {
+    auto size = record.size() - ts_size;
+    push({timestamp, 0, 0, size, 0, 0, ts_size, -1}, record);
+}
+
+/// Insert a new packet whose text is compressed.
+void ReorderWindow::update(time_t timestamp, std::string &&record,
+                           std::size_t size, std::size_t ts_size) {
+    auto packed_size = record.size() - ts_size;
+    push({timestamp, 0, 0, size, packed_size, 0, ts_size, -1}, record);
+}
+
+/// Insert a new packet whose text is left in the input file.
+void ReorderWindow::update(time_t timestamp, int file_idx, long offset,
+                           std::size_t size, std::string &&record) {
+    push({timestamp, 0, offset, size, 0, 0, record.size(), file_idx},
+         record);
+}
+
+/// Add the entry to the heap, with its record appended to the arena.
+/// Conditionally evict older packets to the output if the window size is
+/// exceeded.
+void ReorderWindow::push(Entry entry, const std::string &record) {
+    auto memory_size = packet_memory_size(record.size());
+    charge_memory(MemoryUse::ReorderWindow, memory_size);
+    held_size += memory_size;
+    auto record_offset = static_cast<long>(arena.size());
+    arena.append(record);
+    if (entry.file_idx < 0) {
+        entry.offset = record_offset;
+    }
+    entry.ts_offset = record_offset
+                      + static_cast<long>(record.size() - entry.ts_size);
+
+    if (auto_sizing) {
+        retune(entry.timestamp);
+    }
+    if (heap.empty() || entry.timestamp > largest_time) {
+        largest_time = entry.timestamp;
+    }
+    entry.seq_num = next_seq_num++;
+    heap.push_back(entry);
+    std::push_heap(heap.begin(), heap.end(), is_newer<Entry>);
 
     // Evict all older packets causing the exceeding of the
-    // window size.
-    auto largest_time = window.rbegin()->first;
-    for (auto it = window.begin();
-         largest_time - it->first > ooo_tolerance;
-         it = window.erase(it)) {
-        (*g_output) << it->second << std::endl;
+    // window size, or of the memory cap.
+    while (largest_time - heap.front().timestamp > ooo_tolerance
+           || (held_size > memory_cap && heap.size() > 1)) {
+        pop();
+    }
+    if (dead_size > arena.size() / 2) {
+        compact();
+    }
+}
+
+/// Resize the window by the inversion distance of the packet about to be
+/// inserted.
+void ReorderWindow::retune(time_t timestamp) {
+    if (next_seq_num == 0) {
+        epoch_start = timestamp;
+        return;
+    }
+    if (largest_time - epoch_start >= REORDER_AUTO_EPOCH) {
+        last_epoch_inversion = epoch_inversion;
+        epoch_inversion = 0;
+        epoch_start = largest_time;
+        ooo_tolerance = std::max<time_t>(
+            REORDER_AUTO_MIN_WINDOW,
+            REORDER_AUTO_SAFETY_FACTOR * last_epoch_inversion
+        );
+    }
+    auto inversion = largest_time - timestamp;
+    if (inversion > epoch_inversion) {
+        epoch_inversion = inversion;
+        largest_inversion = std::max(largest_inversion, inversion);
+        ooo_tolerance = std::max<time_t>(
+            ooo_tolerance, REORDER_AUTO_SAFETY_FACTOR * inversion
+        );
     }
 }
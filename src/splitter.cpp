@@ -19,18 +19,43 @@
  * file lexically, rather than gramatically. In other words, it does not
  * verify the input file to have correct XML format. It makes decisions
  * on seeing "<", "</", ">" and "/>".
+ * 
+ * By default, the input files are split one after another, like `cat`. In
+ * the merge mode, every input file is split by its own reader thread, which
+ * also finds the timestamp of each packet in the raw text and queues the
+ * packets. The splitter thread then merges the queued packets of all inputs
+ * by their timestamps with a loser tree, so the inputs are interleaved as
+ * if they had been captured together. Each input is assumed to be sorted
+ * by itself. A packet without a valid timestamp keeps the timestamp of the
+ * packet before it in the same input, so it stays right after that packet.
  */
 
 #include "splitter.hpp"
 #include "extractor.hpp"
+#include "actions.hpp"
+#include "loser_tree.hpp"
+#include "thread_placement.hpp"
 #include "global_states.hpp"
 #include "exceptions.hpp"
 #include "parameters.hpp"
 #include "macros.hpp"
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
 #include <iostream>
 #include <fstream>
 #include <thread>
 #include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #ifdef ACCEL_AVAIL
 #include <emmintrin.h>
@@ -82,18 +107,65 @@ class BufReader {
     int idx;
     // The length of the buffered data.
     int end;
+    // The number of characters read from the input stream.
+    long read_size;
     // The associated input stream.
     std::istream *input;
+    // The file descriptor read instead of `input`, or -1.
+    int fd;
+    // The flag which interrupts the reading of `fd`.
+    const std::atomic<bool> *stopping;
+
+    /// Read from `fd` what is available, up to the size of the buffer.
+    /// Wait for it in slices, so that a stalled pipe does not hold back
+    /// `stopping`. Return 0 at EOF or once stopping.
+    int read_descriptor() {
+        while (!*stopping) {
+            struct pollfd poll_fd = {fd, POLLIN, 0};
+            auto ready = ::poll(&poll_fd, 1, INPUT_POLL_INTERVAL_MS);
+            if (ready > 0) {
+                auto got = ::read(fd, buf, BUFF_SIZE);
+                if_likely (got >= 0) {
+                    return static_cast<int>(got);
+                }
+            }
+            if_unlikely (ready != 0 && errno != EINTR && errno != EAGAIN) {
+                throw UnexpectedCase(
+                    "Failed to read the input: "
+                    + std::string(std::strerror(errno))
+                );
+            }
+        }
+        return 0;
+    }
 
  public:
     BufReader() noexcept {
         input = nullptr;
+        fd = -1;
+        stopping = nullptr;
         idx = end = 0;
+        read_size = 0;
     }
 
-    /// Set the input stream. The internal buffer will NOT be cleared.
+    /// Set the input stream. The internal buffer will NOT be cleared, but
+    /// the offset starts again from 0.
     void set_input(std::istream *input) noexcept {
         this->input = input;
+        read_size = end - idx;
+    }
+
+    /// Read the file descriptor instead of an input stream, until the flag
+    /// `stopping` is set. The offset starts again from 0.
+    void set_input(int fd, const std::atomic<bool> *stopping) noexcept {
+        this->fd = fd;
+        this->stopping = stopping;
+        read_size = end - idx;
+    }
+
+    /// The offset in the input stream of the next character to be read.
+    long offset() const noexcept {
+        return read_size - (end - idx);
     }
 
     /// Get a single character. Return `true` if successful, `false` if
@@ -102,9 +174,14 @@ class BufReader {
     bool buffered_getchar(char &c) {
         // Read more from the input file if the buffer runs out.
         if (idx == end) {
-            input->read(buf, BUFF_SIZE);
+            if (fd >= 0) {
+                end = read_descriptor();
+            } else {
+                input->read(buf, BUFF_SIZE);
+                end = input->gcount();
+            }
             idx = 0;
-            end = input->gcount();
+            read_size += end;
 
             // Return false if we reach EOF.
             if (end == 0) {
@@ -195,14 +272,73 @@ static std::atomic<bool> g_early_terminating(false);
 /// to the `g_inputs` vector.
 static int g_current_file_idx = 0;
 
-/// Current line number of the file being processed.
-static long g_current_line_number = 1;
+/// The lexical splitter of an input stream.
+struct InputSplitter {
+    BufReader reader;
+    /// Current line number of the file being processed.
+    long current_line_number = 1;
+    /// The line number that corresponds to the start of the XML string
+    /// currently being processed.
+    long start_line_number = 0;
+    /// The offset of the XML string currently being processed.
+    long start_offset = 0;
+};
 
-/// The line number that corresponds to the start of the XML string
-/// currently being processed.
-static long g_start_line_number = 0;
+/// A packet split from the input.
+struct SplitPacket {
+    std::string xml_string;
+    /// The index of the input file, i.e. the index to `g_inputs`.
+    int file_idx;
+    long file_offset;
+    long start_line_number;
+    long end_line_number;
+};
+
+/// A packet of an input read ahead in the merge mode.
+struct MergePacket {
+    time_t timestamp;
+    SplitPacket packet;
+};
+
+/// The reader of an input in the merge mode. Its thread splits the input
+/// and queues the packets, until the queue holds `MERGE_READ_AHEAD_SIZE`
+/// bytes. It reads the input file through its own file descriptor, so that
+/// it can be stopped while waiting on a pipe.
+struct MergeReader {
+    InputSplitter splitter;
+    /// The file descriptor of the input, or -1 if it is not opened by the
+    /// reader.
+    int fd = -1;
+    std::thread thread;
+    /// The mutex lock guarding the states shared with the thread below.
+    std::mutex mtx;
+    /// The condition variable used to notify that the queue has changed, or
+    /// that the reader has finished.
+    std::condition_variable queue_changed_cv;
+    std::deque<MergePacket> queue;
+    /// The total XML text size in `queue`.
+    std::size_t queued_size = 0;
+    /// Whether the thread has finished.
+    bool finished = false;
+    /// The exception raised by the thread.
+    std::exception_ptr error = nullptr;
+    /// The next packet of the input to be merged, taken out of the queue by
+    /// the splitter thread.
+    MergePacket head;
+    /// Whether the input has no more packet to be merged.
+    bool exhausted = false;
+};
+
+/// The splitter of the input files processed one after another.
+static InputSplitter g_input_splitter;
 
-static BufReader g_buf_reader;
+/// The readers of all input files in the merge mode.
+static std::vector<std::unique_ptr<MergeReader>> g_merge_readers;
+
+/// The flag telling the readers in the merge mode to stop.
+static std::atomic<bool> g_merge_stopping(false);
+
+static std::string next_subtree(InputSplitter &splitter);
 
 /// Provide the input file name and start running the lexical splitter.
 void start_splitter() {
@@ -221,7 +357,10 @@ void join_splitter() {
 /// Prematurely stop the lexical splitter. It does NOT join the thread.
 /// One should call join_splitter() after calling this function.
 void kill_splitter() {
-    g_early_terminating.store(false);
+    g_early_terminating.store(true);
+    // The readers of the merge mode stop within `INPUT_POLL_INTERVAL_MS`,
+    // which also wakes up the splitter waiting for their packets.
+    g_merge_stopping.store(true);
 }
 
 /// When the splitter has finished execution, it calls this funcion
@@ -246,46 +385,223 @@ static void notify_main_thread() {
     }
 }
 
+/// The entrance function of the reader of an input in the merge mode.
+static void smain_merge_reader(MergeReader &reader, int file_idx) {
+    try {
+        // The readers are not pinned, since they wait on the input most
+        // of the time, and are as many as the input files.
+        auto timestamp = std::numeric_limits<time_t>::min();
+        while (!g_merge_stopping) {
+            auto xml_subtree = next_subtree(reader.splitter);
+            if (xml_subtree.empty()) {
+                break;
+            }
+            auto packet_timestamp = scan_packet_timestamp(xml_subtree);
+            if (packet_timestamp != static_cast<time_t>(-1)) {
+                timestamp = packet_timestamp;
+            }
+
+            std::unique_lock<std::mutex> lck(reader.mtx);
+            reader.queue_changed_cv.wait(lck, [&reader] {
+                return reader.queued_size < MERGE_READ_AHEAD_SIZE
+                       || g_merge_stopping;
+            });
+            reader.queued_size += xml_subtree.size();
+            reader.queue.push_back({
+                timestamp,
+                {
+                    std::move(xml_subtree),
+                    file_idx,
+                    reader.splitter.start_offset,
+                    reader.splitter.start_line_number,
+                    reader.splitter.current_line_number
+                }
+            });
+            reader.queue_changed_cv.notify_all();
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> guard(reader.mtx);
+        reader.error = std::current_exception();
+    }
+    std::lock_guard<std::mutex> guard(reader.mtx);
+    reader.finished = true;
+    reader.queue_changed_cv.notify_all();
+}
+
+/// Take the next packet of the input into the head of its reader. Block
+/// until it is read.
+static void advance_merge_reader(MergeReader &reader) {
+    std::unique_lock<std::mutex> lck(reader.mtx);
+    reader.queue_changed_cv.wait(lck, [&reader] {
+        return !reader.queue.empty() || reader.finished;
+    });
+    if (reader.queue.empty()) {
+        if (reader.error != nullptr) {
+            std::rethrow_exception(reader.error);
+        }
+        reader.exhausted = true;
+        return;
+    }
+    reader.head = std::move(reader.queue.front());
+    reader.queue.pop_front();
+    reader.queued_size -= reader.head.packet.xml_string.size();
+    reader.queue_changed_cv.notify_all();
+}
+
+/// Start a reader for every input file in the merge mode, and wait for the
+/// first packet of each of them.
+static void start_merge_readers() {
+    g_merge_stopping = false;
+    g_merge_readers.clear();
+    for (std::size_t i = 0; i < g_inputs.size(); ++i) {
+        g_merge_readers.emplace_back(new MergeReader());
+        auto &reader = *g_merge_readers.back();
+        if (g_inputs[i].get() == &std::cin) {
+            reader.splitter.reader.set_input(STDIN_FILENO, &g_merge_stopping);
+        } else {
+            reader.fd = ::open(g_input_file_names[i].c_str(), O_RDONLY);
+            if (reader.fd < 0) {
+                throw UnexpectedCase(
+                    "Failed to open input file: \"" + g_input_file_names[i]
+                    + "\": " + std::string(std::strerror(errno))
+                );
+            }
+            reader.splitter.reader.set_input(reader.fd, &g_merge_stopping);
+        }
+        reader.thread = std::thread(smain_merge_reader, std::ref(reader),
+                                    static_cast<int>(i));
+    }
+    for (auto &reader : g_merge_readers) {
+        advance_merge_reader(*reader);
+    }
+}
+
+/// Stop and join the readers of the merge mode.
+static void stop_merge_readers() {
+    g_merge_stopping = true;
+    for (auto &reader : g_merge_readers) {
+        {
+            std::lock_guard<std::mutex> guard(reader->mtx);
+            reader->queue_changed_cv.notify_all();
+        }
+        if (reader->thread.joinable()) {
+            reader->thread.join();
+        }
+        if (reader->fd >= 0) {
+            ::close(reader->fd);
+        }
+    }
+    g_merge_readers.clear();
+}
+
+/// Get the next packet of the input files, one file after another. Return
+/// false if all files have been consumed.
+static bool next_packet(SplitPacket &packet) {
+    packet.xml_string = next_ptree_string();
+    packet.file_idx = g_current_file_idx;
+    packet.file_offset = g_input_splitter.start_offset;
+    packet.start_line_number = g_input_splitter.start_line_number;
+    packet.end_line_number = g_input_splitter.current_line_number;
+    return !packet.xml_string.empty();
+}
+
 /// The entrance function of the (sub)thread running the lexical splitter.
 static void smain_splitter() {
     try {
-        // The string that contains "<$top_level_tag> ... </$top_level_tag>".
-        std::string xml_subtree;
+        pin_current_thread(ThreadRole::Splitter);
+
+        // The packet containing "<$top_level_tag> ... </$top_level_tag>".
+        SplitPacket packet;
 
         // The counter of read strings.
         long job_num = 0;
 
-        // Initialize the buffered reader to consume from the first file.
-        g_buf_reader.set_input(g_inputs[g_current_file_idx].get());
+        // The batch of jobs being collected, and when its first job came.
+        JobBatch batch {0, {}, 0};
+        auto batch_open_time = std::chrono::steady_clock::now();
+
+        // Initialize the buffered reader to consume from the first file,
+        // or start reading all files at once in the merge mode. The merge
+        // picks the input whose next packet has the smallest timestamp,
+        // and the earlier input on ties.
+        g_input_splitter.reader.set_input(g_inputs[g_current_file_idx].get());
+        if (g_merge_inputs) {
+            start_merge_readers();
+        }
+        auto is_merged_before = [](int lhs, int rhs) {
+            const auto &lhs_reader = *g_merge_readers[lhs];
+            const auto &rhs_reader = *g_merge_readers[rhs];
+            if (lhs_reader.exhausted || rhs_reader.exhausted) {
+                return !lhs_reader.exhausted;
+            }
+            return lhs_reader.head.timestamp != rhs_reader.head.timestamp
+                   ? lhs_reader.head.timestamp < rhs_reader.head.timestamp
+                   : lhs < rhs;
+        };
+        LoserTree<decltype(is_merged_before)> merge_tree(
+            static_cast<int>(g_merge_readers.size()), is_merged_before
+        );
 
         // Continue to loop unless exiting prematurely.
         while (!g_early_terminating.load()) {
             // Get a piece of the file in the form
-            // "<$top_level_tag> ... </$top_level_tag>".
-            xml_subtree = next_ptree_string();
-
-            // If the returned string is empty, it means we have reached the
-            // end of file. Break the loop.
-            if (xml_subtree.empty()) {
+            // "<$top_level_tag> ... </$top_level_tag>". If there is none,
+            // we have reached the end of all files. Break the loop.
+            if (g_merge_inputs) {
+                auto &reader = *g_merge_readers[merge_tree.winner()];
+                if (reader.exhausted) {
+                    break;
+                }
+                packet = std::move(reader.head.packet);
+                advance_merge_reader(reader);
+                merge_tree.replay();
+            } else if (!next_packet(packet)) {
                 break;
             }
 
-            // Otherwize, send it to the exetractors.
-            produce_job_to_extractor({
+            // Otherwize, add it to the batch, and send the batch to the
+            // extractors once it is large enough, or earlier if some
+            // extractor has nothing to do, as long as the batch is not tiny
+            // or has waited long enough.
+            if (batch.jobs.empty()) {
+                batch_open_time = std::chrono::steady_clock::now();
+            }
+            batch.xml_size += packet.xml_string.size();
+            batch.jobs.push_back({
                 job_num++,
-                std::move(xml_subtree),
-                g_input_file_names[g_current_file_idx],
-                g_start_line_number,
-                g_current_line_number
+                std::move(packet.xml_string),
+                g_input_file_names[packet.file_idx],
+                packet.file_idx,
+                packet.file_offset,
+                packet.start_line_number,
+                packet.end_line_number
             });
+            if (batch.xml_size >= JOB_BATCH_SIZE
+                || (is_extractor_idle()
+                    && (batch.xml_size >= JOB_BATCH_MIN_SIZE
+                        || std::chrono::steady_clock::now() - batch_open_time
+                           >= std::chrono::microseconds(
+                                  JOB_BATCH_MAX_DELAY_US)))) {
+                auto batch_num = batch.batch_num;
+                produce_job_to_extractor(std::move(batch));
+                batch = JobBatch {batch_num + 1, {}, 0};
+            }
         }
 
+        // Send the last batch.
+        if (!batch.jobs.empty() && !g_early_terminating) {
+            produce_job_to_extractor(std::move(batch));
+        }
+
+        stop_merge_readers();
+
         // If we are not exiting prematurely, we should notify the main thread
         // that the splitter has finished all its work.
         if_unlikely (!g_early_terminating) {
             notify_main_thread();
         }
     } catch (...) {
+        stop_merge_readers();
         propagate_exeption_to_main();
     }
 }
@@ -391,17 +707,14 @@ static bool buffered_getchar(char &c, std::istream &input) {
     return true;
 }
 
-/// Get the next subtree in the opened XML file. The returned string is a
-/// slice of the input XML file in the form like
-/// "<$top_level_tag> ... </$top_level_tag>". Note that since the splitter
-/// is only running on the lexical level, rather than the grammar level,
-/// it assumes that the input file is in valid XML format. It defers the
-/// validation of the format to the following modules, where an exception
-/// will be raised if the returned string is malformated because the input
-/// is not a valid XML file.
-std::string next_ptree_string() {
+/// Get the next subtree of the input of the splitter. Return an empty string
+/// at the end of the input.
+static std::string next_subtree(InputSplitter &splitter) {
+    auto &reader = splitter.reader;
+    auto &line_number = splitter.current_line_number;
+
     // Current input character.
-    char c;
+    char c = '\0';
 
     // The string to be returned.
     std::string tree;
@@ -410,8 +723,8 @@ std::string next_ptree_string() {
     int depth = 0;
 
     // Skip characters until we see an "<".
-    while (g_buf_reader.buffered_getchar(c) && c != '<') {
-        if (c == '\n') ++g_current_line_number;
+    while (reader.buffered_getchar(c) && c != '<') {
+        if (c == '\n') ++line_number;
     }
 
     // If the previous loop stopped because we saw "<", search for the
@@ -423,8 +736,9 @@ std::string next_ptree_string() {
         // Set the state to the starting state.
         MachineState state = MachineState::AngleClosed;
 
-        // Update starting line number of current XML string.
-        g_start_line_number = g_current_line_number;
+        // Update starting line number and offset of current XML string.
+        splitter.start_line_number = line_number;
+        splitter.start_offset = reader.offset() - 1;
 
 #ifdef ACCEL_AVAIL
         bool sse_accel = false;
@@ -489,9 +803,9 @@ std::string next_ptree_string() {
             if (sse_accel) {
                 // If the attempt to get a chunk is successful, append them to
                 // the XML string and increase line number counter accordingly.
-                while (g_buf_reader.buffered_getchunk(chunk, line_cnt)) {
+                while (reader.buffered_getchunk(chunk, line_cnt)) {
                     tree += chunk;
-                    g_current_line_number += line_cnt;
+                    line_number += line_cnt;
                 }
 
                 // The last attempt is unsuccessful. Turn off the SSE
@@ -504,25 +818,38 @@ std::string next_ptree_string() {
             // Read the next character in the file. If we fail to read the next
             // character, the file is corrupted. We defer to the extractor to
             // throw an exception.
-            if_unlikely (!g_buf_reader.buffered_getchar(c)) {
+            if_unlikely (!reader.buffered_getchar(c)) {
                 break;
             }
 
             if (c == '\n') {
-                ++g_current_line_number;
+                ++line_number;
             }
         }
+    }
+    return tree;
+}
+
+/// Get the next subtree in the opened XML file. The returned string is a
+/// slice of the input XML file in the form like
+/// "<$top_level_tag> ... </$top_level_tag>". Note that since the splitter
+/// is only running on the lexical level, rather than the grammar level,
+/// it assumes that the input file is in valid XML format. It defers the
+/// validation of the format to the following modules, where an exception
+/// will be raised if the returned string is malformated because the input
+/// is not a valid XML file.
+std::string next_ptree_string() {
+    auto tree = next_subtree(g_input_splitter);
+    if (!tree.empty()) {
         return tree;
+    }
 
-    // Otherwise, we have finished this file. Go to the next.
-    } else {
-        // If we have finished processing all input files, return an empty
-        // string. `tree` is empty here.
-        if (++g_current_file_idx == g_inputs.size()) {
-            return tree;
-        }
-        g_current_line_number = 1;
-        g_buf_reader.set_input(g_inputs[g_current_file_idx].get());
-        return next_ptree_string();
+    // Otherwise, we have finished this file. Go to the next. If we have
+    // finished processing all input files, return an empty string.
+    if (++g_current_file_idx == g_inputs.size()) {
+        return tree;
     }
+    g_input_splitter.current_line_number = 1;
+    g_input_splitter.reader.set_input(g_inputs[g_current_file_idx].get());
+    return next_ptree_string();
 }
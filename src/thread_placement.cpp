@@ -0,0 +1,302 @@
+/**
+ * Copyright [2020] Zhiyao Ma
+ *
+ * This module implements the placement of the pipeline threads on CPUs.
+ *
+ * The splitter and the in-order executor are serial stages, so each of them
+ * gets a dedicated CPU, and the extractors are spread over the remaining
+ * ones, one CPU each as long as there are enough. The CPUs are taken node
+ * by node, starting from the NUMA node of the splitter, so that the job
+ * strings allocated by the splitter are consumed on the same node whenever
+ * the extractors fit there. The output writer may run on any CPU of the
+ * node of the in-order executor, which fills the buffers it writes.
+ *
+ * Every thread pins itself before allocating its own buffers, such as the
+ * pool of ordered tasks of an extractor or the output buffers of the
+ * in-order executor, so that the pages are first touched, and thus
+ * allocated, on the node that uses them.
+ *
+ * The NUMA topology is read from sysfs. Without it, all CPUs are assumed to
+ * be on node 0. The CPU quota of the cgroup, which bounds the number of
+ * CPUs a container may keep busy, is read from cgroupfs, either v2 or v1.
+ */
+#include "thread_placement.hpp"
+#include "exceptions.hpp"
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <utility>
+
+/// The CPUs planned for each role, or empty if threads are not pinned.
+static std::vector<int> g_splitter_cpus;
+static std::vector<int> g_executor_cpus;
+static std::vector<int> g_writer_cpus;
+/// The CPU of each extractor, indexed by the worker id.
+static std::vector<int> g_extractor_cpus;
+/// The NUMA node of each CPU.
+static std::map<int, int> g_cpu_nodes;
+
+/// Parse a CPU list like "0-3,8,10-11". The CPUs are returned in the order
+/// given, without duplicates.
+std::vector<int> parse_cpu_list(const std::string &str) {
+    std::vector<int> cpus;
+    std::stringstream stream(str);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        int first, last;
+        char dash, rest;
+        std::stringstream range_stream(range);
+        if (!(range_stream >> first)) {
+            throw ArgumentError("Invalid CPU list: \"" + str + "\"");
+        }
+        if (range_stream >> dash) {
+            if (dash != '-' || !(range_stream >> last)
+                || range_stream >> rest) {
+                throw ArgumentError("Invalid CPU list: \"" + str + "\"");
+            }
+        } else {
+            last = first;
+        }
+        if (first < 0 || first > last || last >= CPU_SETSIZE) {
+            throw ArgumentError("Invalid CPU list: \"" + str + "\"");
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            if (std::find(cpus.begin(), cpus.end(), cpu) == cpus.end()) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    if (cpus.empty()) {
+        throw ArgumentError("Invalid CPU list: \"" + str + "\"");
+    }
+    return cpus;
+}
+
+/// Return the CPUs the process is allowed to run on.
+std::vector<int> get_available_cpus() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        throw UnexpectedCase(
+            "Failed to get the CPU affinity: "
+            + std::string(std::strerror(errno))
+        );
+    }
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &set)) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+/// Return the CPU quota of the cgroup in CPUs, rounded up, or 0 if there is
+/// no quota.
+static int get_cgroup_cpu_quota() {
+    long quota = -1, period = 0;
+    // cgroup v2: "$quota $period", where the quota may be "max".
+    std::ifstream v2_file("/sys/fs/cgroup/cpu.max");
+    std::string quota_str;
+    if (v2_file >> quota_str >> period) {
+        if (quota_str != "max") {
+            quota = std::atol(quota_str.c_str());
+        }
+    } else {
+        // cgroup v1: the quota is -1 if there is none.
+        std::ifstream quota_file("/sys/fs/cgroup/cpu/cpu.cfs_quota_us");
+        std::ifstream period_file("/sys/fs/cgroup/cpu/cpu.cfs_period_us");
+        if (!(quota_file >> quota) || !(period_file >> period)) {
+            return 0;
+        }
+    }
+    if (quota <= 0 || period <= 0) {
+        return 0;
+    }
+    return static_cast<int>((quota + period - 1) / period);
+}
+
+/// Return the number of CPUs the process may keep busy.
+int get_usable_cpu_num() {
+    int cpu_num = static_cast<int>(get_available_cpus().size());
+    auto quota = get_cgroup_cpu_quota();
+    if (quota > 0) {
+        cpu_num = std::min(cpu_num, quota);
+    }
+    return std::max(cpu_num, 1);
+}
+
+/// Read the NUMA node of every CPU from sysfs.
+static void read_cpu_nodes() {
+    g_cpu_nodes.clear();
+    const char *node_dir = "/sys/devices/system/node";
+    auto dir = opendir(node_dir);
+    if (dir == nullptr) {
+        return;
+    }
+    while (auto entry = readdir(dir)) {
+        int node;
+        if (std::sscanf(entry->d_name, "node%d", &node) != 1) {
+            continue;
+        }
+        std::ifstream file(std::string(node_dir) + "/" + entry->d_name
+                           + "/cpulist");
+        std::string cpulist;
+        if (!std::getline(file, cpulist) || cpulist.empty()) {
+            continue;
+        }
+        for (auto cpu : parse_cpu_list(cpulist)) {
+            g_cpu_nodes[cpu] = node;
+        }
+    }
+    closedir(dir);
+}
+
+/// Return the NUMA node of the CPU.
+static int node_of(int cpu) {
+    auto it = g_cpu_nodes.find(cpu);
+    return it == g_cpu_nodes.end() ? 0 : it->second;
+}
+
+/// Plan the placement of the pipeline threads on the given CPUs, with
+/// `extractor_num` extractor threads.
+void set_thread_placement(const std::vector<int> &cpus, int extractor_num) {
+    auto available = get_available_cpus();
+    for (auto cpu : cpus) {
+        if (std::find(available.begin(), available.end(), cpu)
+            == available.end()) {
+            throw ArgumentError(
+                "CPU " + std::to_string(cpu) + " is not available."
+            );
+        }
+    }
+    read_cpu_nodes();
+
+    // Order the CPUs node by node, starting from the node of the first one,
+    // and keep the given order within each node.
+    auto first_node = node_of(cpus.front());
+    auto ordered = cpus;
+    std::stable_sort(
+        ordered.begin(), ordered.end(),
+        [first_node](int lhs, int rhs) {
+            auto lhs_node = node_of(lhs), rhs_node = node_of(rhs);
+            if ((lhs_node == first_node) != (rhs_node == first_node)) {
+                return lhs_node == first_node;
+            }
+            return lhs_node < rhs_node;
+        }
+    );
+
+    // Dedicate the first CPU to the splitter and the next one to the
+    // in-order executor. The extractors share all CPUs if none is left.
+    std::size_t dedicated = std::min<std::size_t>(2, ordered.size() - 1);
+    g_splitter_cpus = {ordered[0]};
+    g_executor_cpus = {ordered[dedicated == 2 ? 1 : 0]};
+    std::vector<int> rest(ordered.begin() + dedicated, ordered.end());
+    g_extractor_cpus.clear();
+    for (int i = 0; i < extractor_num; ++i) {
+        g_extractor_cpus.push_back(rest[i % rest.size()]);
+    }
+
+    auto executor_node = node_of(g_executor_cpus.front());
+    g_writer_cpus.clear();
+    for (auto cpu : ordered) {
+        if (node_of(cpu) == executor_node) {
+            g_writer_cpus.push_back(cpu);
+        }
+    }
+}
+
+/// Pin the calling thread to the CPUs planned for its role.
+void pin_current_thread(ThreadRole role, int index) {
+    const std::vector<int> *cpus = nullptr;
+    std::vector<int> extractor_cpu;
+    switch (role) {
+    case ThreadRole::Splitter:
+        cpus = &g_splitter_cpus;
+        break;
+    case ThreadRole::Extractor:
+        if (index < static_cast<int>(g_extractor_cpus.size())) {
+            extractor_cpu.push_back(g_extractor_cpus[index]);
+        }
+        cpus = &extractor_cpu;
+        break;
+    case ThreadRole::InOrderExecutor:
+        cpus = &g_executor_cpus;
+        break;
+    case ThreadRole::OutputWriter:
+        cpus = &g_writer_cpus;
+        break;
+    }
+    if (cpus->empty()) {
+        return;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto cpu : *cpus) {
+        CPU_SET(cpu, &set);
+    }
+    auto err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0) {
+        throw UnexpectedCase(
+            "Failed to set the CPU affinity: " + std::string(std::strerror(err))
+        );
+    }
+}
+
+/// Format the CPUs as ranges grouped by NUMA node, like
+/// "2-7 (node 0), 8-15 (node 1)".
+static std::string format_cpus(std::vector<int> cpus) {
+    std::stable_sort(
+        cpus.begin(), cpus.end(),
+        [](int lhs, int rhs) {
+            return std::make_pair(node_of(lhs), lhs)
+                   < std::make_pair(node_of(rhs), rhs);
+        }
+    );
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+
+    std::string text;
+    std::size_t i = 0;
+    while (i < cpus.size()) {
+        auto node = node_of(cpus[i]);
+        std::string ranges;
+        while (i < cpus.size() && node_of(cpus[i]) == node) {
+            auto j = i;
+            while (j + 1 < cpus.size() && node_of(cpus[j + 1]) == node
+                   && cpus[j + 1] == cpus[j] + 1) {
+                ++j;
+            }
+            ranges += (ranges.empty() ? "" : ",") + std::to_string(cpus[i]);
+            if (j > i) {
+                ranges += "-" + std::to_string(cpus[j]);
+            }
+            i = j + 1;
+        }
+        text += (text.empty() ? "" : ", ") + ranges
+                + " (node " + std::to_string(node) + ")";
+    }
+    return text;
+}
+
+/// Describe the planned placement, one role per line.
+std::string describe_thread_placement() {
+    if (g_splitter_cpus.empty()) {
+        return "Thread placement: not pinned\n";
+    }
+    return "Thread placement:\n"
+           "  splitter: CPU " + format_cpus(g_splitter_cpus) + "\n"
+           "  extractors (" + std::to_string(g_extractor_cpus.size())
+           + "): CPU " + format_cpus(g_extractor_cpus) + "\n"
+           "  in-order executor: CPU " + format_cpus(g_executor_cpus) + "\n"
+           "  output writer: CPU " + format_cpus(g_writer_cpus) + "\n";
+}
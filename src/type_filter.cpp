@@ -0,0 +1,61 @@
+/**
+ * Copyright [2020] Zhiyao Ma
+ * 
+ * This module implements a packet type matcher for the filter mode.
+ * 
+ * A trace usually contains only about a hundred distinct packet types,
+ * while the regular expression matching is expensive. The matcher keeps
+ * the decision for each packet type seen so far in a fixed size, lock-free
+ * hash table shared by all extractor threads. Only the first occurrence
+ * of each packet type runs the regular expression.
+ */
+
+#include "type_filter.hpp"
+#include "parameters.hpp"
+#include "macros.hpp"
+
+PacketTypeFilter::PacketTypeFilter(const std::string &pattern)
+    : regex(pattern, std::regex::ECMAScript | std::regex::optimize),
+      slots(new Slot[PACKET_TYPE_CACHE_SIZE]) {
+    for (int i = 0; i < PACKET_TYPE_CACHE_SIZE; ++i) {
+        slots[i].state.store(EMPTY, std::memory_order_relaxed);
+    }
+}
+
+/// Return true if and only if the packet type matches the regular
+/// expression. The slot is claimed by a CAS on its state, and the
+/// decision is published with a release store, so readers never block.
+bool PacketTypeFilter::match(const std::string &type) {
+    auto hash = std::hash<std::string>()(type);
+    for (int probe = 0; probe < PACKET_TYPE_CACHE_SIZE; ++probe) {
+        auto &slot = slots[(hash + probe) & (PACKET_TYPE_CACHE_SIZE - 1)];
+        auto state = slot.state.load(std::memory_order_acquire);
+
+        // Claim the empty slot and publish the decision.
+        if (state == EMPTY) {
+            if (slot.state.compare_exchange_strong(
+                    state, WRITING, std::memory_order_acquire)) {
+                slot.hash = hash;
+                slot.type = type;
+                slot.matched = std::regex_match(type, regex);
+                slot.state.store(READY, std::memory_order_release);
+                return slot.matched;
+            }
+        }
+
+        // Another thread is filling in the slot. We do not know whether
+        // it holds the same type, so evaluate the regex by ourselves
+        // rather than waiting. This only happens on the first few
+        // occurrences of a packet type.
+        if_unlikely (state == WRITING) {
+            return std::regex_match(type, regex);
+        }
+
+        if (slot.hash == hash && slot.type == type) {
+            return slot.matched;
+        }
+    }
+
+    // The table is full. Fall back to the regex.
+    return std::regex_match(type, regex);
+}
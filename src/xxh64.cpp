@@ -0,0 +1,102 @@
+/**
+ * Copyright [2020] Zhiyao Ma
+ *
+ * This module implements the 64-bit xxHash algorithm (XXH64).
+ *
+ * The data is consumed in stripes of 32 bytes by four independent
+ * accumulators, which keeps the multipliers of the CPU busy, and the tail
+ * is mixed in 8, 4 and 1 bytes at a time. It hashes several GB per second
+ * on a single thread, far faster than the XML text is parsed.
+ */
+#include "xxh64.hpp"
+#include <cstring>
+
+static constexpr std::uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static constexpr std::uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static constexpr std::uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+static constexpr std::uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static constexpr std::uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline std::uint64_t rotate_left(std::uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline std::uint64_t read_u64(const char *p) {
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline std::uint32_t read_u32(const char *p) {
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/// Mix 8 bytes of input into an accumulator.
+static inline std::uint64_t mix_round(std::uint64_t acc,
+                                      std::uint64_t input) {
+    acc += input * PRIME64_2;
+    acc = rotate_left(acc, 31);
+    return acc * PRIME64_1;
+}
+
+/// Merge an accumulator into the hash after the stripes.
+static inline std::uint64_t merge_round(std::uint64_t hash,
+                                        std::uint64_t acc) {
+    hash ^= mix_round(0, acc);
+    return hash * PRIME64_1 + PRIME64_4;
+}
+
+std::uint64_t hash_xxh64(const char *data, std::size_t size) {
+    const char *p = data;
+    const char *end = data + size;
+    std::uint64_t hash;
+
+    if (size >= 32) {
+        std::uint64_t v1 = PRIME64_1 + PRIME64_2;
+        std::uint64_t v2 = PRIME64_2;
+        std::uint64_t v3 = 0;
+        std::uint64_t v4 = 0 - PRIME64_1;
+        const char *limit = end - 32;
+        do {
+            v1 = mix_round(v1, read_u64(p));
+            v2 = mix_round(v2, read_u64(p + 8));
+            v3 = mix_round(v3, read_u64(p + 16));
+            v4 = mix_round(v4, read_u64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        hash = rotate_left(v1, 1) + rotate_left(v2, 7)
+               + rotate_left(v3, 12) + rotate_left(v4, 18);
+        hash = merge_round(hash, v1);
+        hash = merge_round(hash, v2);
+        hash = merge_round(hash, v3);
+        hash = merge_round(hash, v4);
+    } else {
+        hash = PRIME64_5;
+    }
+    hash += static_cast<std::uint64_t>(size);
+
+    for (; p + 8 <= end; p += 8) {
+        hash ^= mix_round(0, read_u64(p));
+        hash = rotate_left(hash, 27) * PRIME64_1 + PRIME64_4;
+    }
+    if (p + 4 <= end) {
+        hash ^= static_cast<std::uint64_t>(read_u32(p)) * PRIME64_1;
+        hash = rotate_left(hash, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        hash ^= static_cast<std::uint64_t>(static_cast<unsigned char>(*p))
+                * PRIME64_5;
+        hash = rotate_left(hash, 11) * PRIME64_1;
+    }
+
+    // Avalanche the bits.
+    hash ^= hash >> 33;
+    hash *= PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
@@ -0,0 +1,26 @@
+/* Copyright [2020] Zhiyao Ma */
+#ifndef TESTS_CHECK_HPP_
+#define TESTS_CHECK_HPP_
+
+#include <iostream>
+
+/// The number of failed checks of the test program.
+static int g_failed_check_num = 0;
+
+/// Report the failure of the condition with its location, and keep going,
+/// so that one run shows all failures.
+#define CHECK(condition)                                                  \
+    do {                                                                  \
+        if (!(condition)) {                                               \
+            std::cerr << __FILE__ << ":" << __LINE__                      \
+                      << ": check failed: " #condition << std::endl;      \
+            ++g_failed_check_num;                                         \
+        }                                                                 \
+    } while (0)
+
+/// Return the exit status of the test program.
+static int check_result() {
+    return g_failed_check_num == 0 ? 0 : 1;
+}
+
+#endif  // TESTS_CHECK_HPP_
@@ -0,0 +1,91 @@
+/**
+ * Copyright [2020] Zhiyao Ma
+ *
+ * Tests of the duplicate filter against a model built on the standard
+ * containers. The hashes share a few home slots, so that the probe
+ * sequences are long, and erasing from them moves the entries back.
+ */
+#include "check.hpp"
+#include "duplicate_filter.hpp"
+#include "exceptions.hpp"
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <random>
+#include <utility>
+
+/// The duplicate filter as specified: a hash is a duplicate if it has been
+/// added within the horizon of the newest timestamp.
+class ModelFilter {
+    time_t horizon;
+    std::map<std::uint64_t, time_t> hashes;
+    std::deque<std::pair<std::uint64_t, time_t>> history;
+    time_t largest_time = 0;
+
+ public:
+    explicit ModelFilter(time_t horizon_) : horizon(horizon_) {}
+
+    bool insert(time_t timestamp, std::uint64_t hash) {
+        if (history.empty() || timestamp > largest_time) {
+            largest_time = timestamp;
+            while (!history.empty()
+                   && largest_time - history.front().second > horizon) {
+                auto it = hashes.find(history.front().first);
+                if (it != hashes.end()
+                    && it->second == history.front().second) {
+                    hashes.erase(it);
+                }
+                history.pop_front();
+            }
+        }
+        if (hashes.count(hash) > 0) {
+            return false;
+        }
+        hashes[hash] = timestamp;
+        history.emplace_back(hash, timestamp);
+        return true;
+    }
+};
+
+static void test_against_model() {
+    std::mt19937_64 random(5);
+    for (int round = 0; round < 10; ++round) {
+        auto horizon = static_cast<time_t>(1 + random() % 50);
+        DuplicateFilter filter(horizon);
+        ModelFilter model(horizon);
+        time_t time = 0;
+        long mismatch_num = 0;
+        for (int i = 0; i < 100000; ++i) {
+            // Slightly disordered timestamps.
+            time += static_cast<time_t>(random() % 3);
+            auto timestamp = time - static_cast<time_t>(random() % 5);
+            std::uint64_t hash = (random() % 3000) * 4096 + random() % 8 + 1;
+            mismatch_num += filter.insert(timestamp, hash)
+                            != model.insert(timestamp, hash);
+        }
+        CHECK(mismatch_num == 0);
+    }
+}
+
+static void test_hash_zero() {
+    DuplicateFilter filter(10);
+    CHECK(filter.insert(0, 0));
+    CHECK(!filter.insert(1, 0));
+}
+
+static void test_invalid_horizon() {
+    auto thrown = false;
+    try {
+        DuplicateFilter filter(0);
+    } catch (const ArgumentError &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+int main() {
+    test_against_model();
+    test_hash_zero();
+    test_invalid_horizon();
+    return check_result();
+}
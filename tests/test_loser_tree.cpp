@@ -0,0 +1,73 @@
+/**
+ * Copyright [2020] Zhiyao Ma
+ *
+ * Tests of the loser tree, merging sorted sources as the sort and the
+ * merge modes do, against a stable sort of all elements.
+ */
+#include "check.hpp"
+#include "loser_tree.hpp"
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+/// Merge the sources with the loser tree. Return the elements in order,
+/// each with the index of its source.
+static std::vector<std::pair<int, int>> merge(
+        const std::vector<std::vector<int>> &sources) {
+    std::vector<std::size_t> positions(sources.size(), 0);
+    auto exhausted = [&](int i) {
+        return positions[i] == sources[i].size();
+    };
+    auto less = [&](int lhs, int rhs) {
+        if (exhausted(lhs) || exhausted(rhs)) {
+            return !exhausted(lhs);
+        }
+        auto lhs_value = sources[lhs][positions[lhs]];
+        auto rhs_value = sources[rhs][positions[rhs]];
+        return lhs_value != rhs_value ? lhs_value < rhs_value : lhs < rhs;
+    };
+    LoserTree<decltype(less)> tree(static_cast<int>(sources.size()), less);
+    std::vector<std::pair<int, int>> merged;
+    while (!sources.empty() && !exhausted(tree.winner())) {
+        auto i = tree.winner();
+        merged.emplace_back(sources[i][positions[i]++], i);
+        tree.replay();
+    }
+    return merged;
+}
+
+static void test_against_sort() {
+    std::mt19937 random(7);
+    for (int source_num = 1; source_num <= 17; ++source_num) {
+        for (int round = 0; round < 20; ++round) {
+            std::vector<std::vector<int>> sources(source_num);
+            std::vector<std::pair<int, int>> expected;
+            for (int i = 0; i < source_num; ++i) {
+                // Some sources are empty, and the values repeat, so that
+                // the ties must go to the earlier source.
+                sources[i].resize(random() % 30);
+                for (auto &value : sources[i]) {
+                    value = static_cast<int>(random() % 20);
+                }
+                std::sort(sources[i].begin(), sources[i].end());
+                for (auto value : sources[i]) {
+                    expected.emplace_back(value, i);
+                }
+            }
+            std::stable_sort(
+                expected.begin(), expected.end(),
+                [](const std::pair<int, int> &lhs,
+                   const std::pair<int, int> &rhs) {
+                    return lhs.first < rhs.first;
+                }
+            );
+            CHECK(merge(sources) == expected);
+        }
+    }
+}
+
+int main() {
+    test_against_sort();
+    return check_result();
+}
@@ -0,0 +1,123 @@
+/**
+ * Copyright [2020] Zhiyao Ma
+ *
+ * Tests of the LZ4 block codec. The decompressor is checked against blocks
+ * produced by the reference library, LZ4_compress_default() of liblz4, and
+ * the compressor by decompressing what it produces.
+ */
+#include "check.hpp"
+#include "lz4_block.hpp"
+#include "exceptions.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// A block compressed by the reference library and the data it holds.
+struct ReferenceBlock {
+    std::string original;
+    std::string compressed;
+};
+
+static std::vector<ReferenceBlock> reference_blocks() {
+    return {
+        {"", std::string("\x00", 1)},
+        {"hello", "\x50hello"},
+        // A match overlapping the bytes being written.
+        {std::string(100, 'a'),
+         std::string("\x1f\x61\x01\x00\x4b\x50\x61\x61\x61\x61\x61", 11)},
+        // Both a literal length and a match length continued by bytes.
+        {"0123456789abcdefghij" + std::string(300, 'x')
+             + "0123456789abcdefghij",
+         std::string("\xff\x06" "0123456789abcdefghijx"
+                     "\x01\x00\xff\x19\x0b\x40\x01\x50" "fghij", 36)},
+        // A packet, with matches of several offsets.
+        {"<dm_log_packet><pair key=\"type_id\">LTE_RRC_OTA_Packet</pair>"
+         "<pair key=\"timestamp\">2020-01-01 00:00:00.000000</pair>"
+         "<pair key=\"type_id\">LTE_RRC_OTA_Packet</pair></dm_log_packet>",
+         std::string("\xf1\x21<dm_log_packet><pair key=\"type_id\">"
+                     "LTE_RRC_OTA_P\x27\x00\x20</\x27\x00\x09\x2d\x00\xf1"
+                     "\x09imestamp\">2020-01-01 00:\x03\x00\x21.0\x01\x00"
+                     "\x0f\x37\x00\x00\x0f\x64\x00\x0f\x15\x2f\xa1\x00\x50"
+                     "cket>", 111)},
+    };
+}
+
+/// Return `size` bytes of a pseudo-random text over an alphabet of
+/// `alphabet_size` letters, so that it has some matches but not only.
+static std::string random_text(std::size_t size, int alphabet_size,
+                               std::uint32_t seed) {
+    std::string text(size, '\0');
+    for (auto &c : text) {
+        seed = seed * 1664525U + 1013904223U;
+        c = static_cast<char>('a' + (seed >> 24) % alphabet_size);
+    }
+    return text;
+}
+
+static std::string round_trip(const std::string &data) {
+    std::string compressed;
+    compress_lz4_block(data.data(), data.size(), compressed);
+    std::string decompressed(data.size(), '\0');
+    decompress_lz4_block(compressed.data(), compressed.size(),
+                         &decompressed[0], decompressed.size());
+    return decompressed;
+}
+
+static void test_reference_blocks() {
+    for (const auto &block : reference_blocks()) {
+        std::string decompressed(block.original.size(), '\0');
+        decompress_lz4_block(block.compressed.data(), block.compressed.size(),
+                             &decompressed[0], decompressed.size());
+        CHECK(decompressed == block.original);
+        CHECK(round_trip(block.original) == block.original);
+    }
+}
+
+static void test_round_trip() {
+    // Every size around the shortest input that may hold a match.
+    for (std::size_t size = 0; size < 64; ++size) {
+        CHECK(round_trip(std::string(size, 'z')) == std::string(size, 'z'));
+        auto text = random_text(size, 4, static_cast<std::uint32_t>(size));
+        CHECK(round_trip(text) == text);
+    }
+
+    // Large inputs, with repeats both within and beyond the 64 KB window,
+    // followed by small ones reusing the hash table of the thread.
+    auto block = random_text(50000, 26, 1);
+    auto repeated = block + random_text(30000, 2, 2) + block;
+    CHECK(round_trip(repeated) == repeated);
+    auto random = random_text(200000, 256, 3);
+    CHECK(round_trip(random) == random);
+    for (std::size_t size = 4096; size > 8; size /= 3) {
+        auto text = random_text(size, 3, static_cast<std::uint32_t>(size));
+        CHECK(round_trip(text) == text);
+    }
+
+    // A compressible text must shrink.
+    std::string compressed;
+    auto text = std::string(1000, 'a') + random_text(1000, 2, 4);
+    compress_lz4_block(text.data(), text.size(), compressed);
+    CHECK(compressed.size() < text.size() / 2);
+}
+
+static void test_malformed_blocks() {
+    const auto &block = reference_blocks()[3];
+    std::string decompressed(block.original.size(), '\0');
+    for (std::size_t size = 0; size < block.compressed.size(); ++size) {
+        auto thrown = false;
+        try {
+            decompress_lz4_block(block.compressed.data(), size,
+                                 &decompressed[0], decompressed.size());
+        } catch (const ProgramBug &) {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+}
+
+int main() {
+    test_reference_blocks();
+    test_round_trip();
+    test_malformed_blocks();
+    return check_result();
+}
@@ -0,0 +1,70 @@
+/**
+ * Copyright [2020] Zhiyao Ma
+ *
+ * Tests of XXH64 against known answers of the reference implementation,
+ * XXH64() of libxxhash with seed 0. The lengths cover every tail of the
+ * input after the 32-byte stripes.
+ */
+#include "check.hpp"
+#include "xxh64.hpp"
+#include <cstdint>
+#include <string>
+
+struct KnownAnswer {
+    std::string data;
+    std::uint64_t hash;
+};
+
+/// Return the first `size` bytes of a fixed pattern.
+static std::string pattern(std::size_t size) {
+    std::string data(size, '\0');
+    for (std::size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<char>((i * 7 + 3) & 0xff);
+    }
+    return data;
+}
+
+static void test_known_answers() {
+    const KnownAnswer answers[] = {
+        {"", 0xef46db3751d8e999ULL},
+        {"a", 0xd24ec4f1a98c6e5bULL},
+        {"abc", 0x44bc2cf5ad770999ULL},
+        {"message digest", 0x066ed728fceeb3beULL},
+        {"abcdefghijklmnopqrstuvwxyz", 0xcfe1f278fa89835cULL},
+        {pattern(1), 0x1f25c8d0bc1f4bb6ULL},
+        {pattern(3), 0x31d2363f52e564c9ULL},
+        {pattern(4), 0x9bb64b7d66ee9fdaULL},
+        {pattern(7), 0x9a7b149959ce60d8ULL},
+        {pattern(8), 0xdab99d95c6f90092ULL},
+        {pattern(15), 0x1b47cb8243cc8e32ULL},
+        {pattern(16), 0x434850232b787be2ULL},
+        {pattern(31), 0xa2aa5f33cc4a6119ULL},
+        {pattern(32), 0x23c3c17ef790fd97ULL},
+        {pattern(33), 0x50a7cfc7ba588784ULL},
+        {pattern(63), 0x5e3e54b431c7493cULL},
+        {pattern(64), 0x0eb64b3ef6eeb01fULL},
+        {pattern(100), 0xa61f8d4c170fe531ULL},
+        {pattern(200), 0xa6cb3c09bc829b24ULL},
+    };
+    for (const auto &answer : answers) {
+        CHECK(hash_xxh64(answer.data.data(), answer.data.size())
+              == answer.hash);
+    }
+}
+
+/// The hash must not depend on the alignment of the data.
+static void test_unaligned_data() {
+    auto data = pattern(200);
+    auto expected = hash_xxh64(data.data(), data.size());
+    for (std::size_t shift = 1; shift < 8; ++shift) {
+        std::string shifted(shift, '\0');
+        shifted += data;
+        CHECK(hash_xxh64(shifted.data() + shift, data.size()) == expected);
+    }
+}
+
+int main() {
+    test_known_answers();
+    test_unaligned_data();
+    return check_result();
+}